@@ -0,0 +1,404 @@
+// arx_simd.h
+// Internal ARX backend shared by chacha20.c, chacha20_simd.c, salsa.c and
+// blake3.c: platform detection, scalar rotates and little-endian
+// load/store, the key-material wipe (also used by the AEADs, the RNG and
+// scrypt), vector rotates for each ISA, the in-register 4x4 word
+// transposes that turn word-per-vector state into block-per-vector rows
+// and back, and the multi-lane state vectors of the stream kernels (see
+// "ARX state vectors" below). Not a public header.
+
+#ifndef ARX_SIMD_H
+#define ARX_SIMD_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+  #include <arm_neon.h>
+  #define HAVE_NEON 1
+#else
+  #define HAVE_NEON 0
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+  #include <immintrin.h>
+  #include <cpuid.h>
+  #define HAVE_X86 1
+#else
+  #define HAVE_X86 0
+#endif
+
+//ROTL32(x, r):
+//  Perform a 32-bit circular left rotation of x by r bits.
+//  This is the basic bit-mixing primitive in ChaCha, allowing low-cost nonlinear diffusion
+//  by repositioning bits within a word before XOR/add operations
+// 32-bit left rotate
+static inline uint32_t ROTL32(uint32_t x, int r) {
+    return (x << r) | (x >> (32 - r));
+}
+// 32-bit right rotate, as BLAKE3 writes its G function
+static inline uint32_t ROTR32(uint32_t x, int r) {
+    return (x >> r) | (x << (32 - r));
+}
+
+// little-endian load/store
+static inline uint32_t load32_le(const uint8_t *p) {
+    return (uint32_t)p[0]        
+         | ((uint32_t)p[1] << 8)  
+         | ((uint32_t)p[2] << 16) 
+         | ((uint32_t)p[3] << 24);
+}
+static inline void store32_le(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+// arx_wipe(p, n):
+//   Zero n bytes of key material or keystream before they go out of scope
+//   or back to the allocator. A plain memset there is a dead store the
+//   compiler may drop; GCC/Clang get memset plus an empty asm that claims
+//   to read the memory, elsewhere a volatile byte loop.
+static inline void arx_wipe(void *p, size_t n) {
+#if defined(__GNUC__)
+    memset(p, 0, n);
+    __asm__ __volatile__("" : : "r"(p) : "memory");
+#else
+    volatile uint8_t *v = (volatile uint8_t *)p;
+    for (size_t i = 0; i < n; i++) {
+        v[i] = 0;
+    }
+#endif
+}
+
+// ARX_UNROLL:
+//   Placed in front of round loops. Kernels are always_inline templates
+//   with a `rounds` argument instantiated with constant round counts, so
+//   with this hint each instance's round loop is unrolled completely.
+#if defined(__clang__)
+  #define ARX_UNROLL _Pragma("unroll")
+#elif defined(__GNUC__)
+  #define ARX_UNROLL _Pragma("GCC unroll 10")
+#else
+  #define ARX_UNROLL
+#endif
+
+// arx_ctr_add(state, ctr, n, ctr64):
+//   Advance the block counter in word ctr by n blocks. A 32-bit counter
+//   wraps; with ctr64 words ctr and ctr+1 form one 64-bit counter, low
+//   word first, and the carry goes into ctr+1.
+static inline void arx_ctr_add(uint32_t state[16], int ctr, uint32_t n, int ctr64) {
+    uint32_t lo = state[ctr] + n;
+    if (ctr64 && lo < state[ctr]) {
+        state[ctr + 1]++;
+    }
+    state[ctr] = lo;
+}
+
+// arx_xor_bytes(out, in, ks, n): out = in ^ ks for the tail of a block
+static inline void arx_xor_bytes(uint8_t *out, const uint8_t *in,
+                                 const uint8_t *ks, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        out[i] = in[i] ^ ks[i];
+    }
+}
+
+#if HAVE_NEON
+// NEON_ROTL(v, n): rotate every 32-bit lane left by the constant n
+#define NEON_ROTL(v, n) vorrq_u32(vshlq_n_u32(v, n), vshrq_n_u32(v, 32 - (n)))
+
+// NEON_TRANSPOSE4(a, b, c, d):
+//   4x4 transpose of 32-bit words, the NEON form of SSE_TRANSPOSE4: vtrnq
+//   pairs up words of a/b and c/d, then the 64-bit halves are zipped
+//   together (vcombine of the low/high halves, zip1/zip2 on AArch64). On
+//   exit vector k holds four consecutive words of block k.
+#define NEON_TRANSPOSE4(a, b, c, d)                                     \
+    do {                                                                \
+        uint32x4x2_t ab_ = vtrnq_u32(a, b);                             \
+        uint32x4x2_t cd_ = vtrnq_u32(c, d);                             \
+        a = vcombine_u32(vget_low_u32(ab_.val[0]),  vget_low_u32(cd_.val[0]));  \
+        b = vcombine_u32(vget_low_u32(ab_.val[1]),  vget_low_u32(cd_.val[1]));  \
+        c = vcombine_u32(vget_high_u32(ab_.val[0]), vget_high_u32(cd_.val[0])); \
+        d = vcombine_u32(vget_high_u32(ab_.val[1]), vget_high_u32(cd_.val[1])); \
+    } while (0)
+#endif
+
+#if HAVE_X86
+// SSE_ROTL / AVX2_ROTL(v, n): shift/or rotate by the constant n (SSE2).
+#define SSE_ROTL(v, n)  _mm_or_si128(_mm_slli_epi32(v, n), _mm_srli_epi32(v, 32 - (n)))
+#define AVX2_ROTL(v, n) _mm256_or_si256(_mm256_slli_epi32(v, n), _mm256_srli_epi32(v, 32 - (n)))
+
+// SSSE3_ROTL8/16/24, AVX2_ROTL8/16/24(v): rotates by whole bytes are one
+// pshufb. The mask is a constant the compiler keeps in a register across
+// the round loop. vpshufb shuffles within 128-bit halves, so the AVX2
+// mask is the 16-byte pattern twice.
+#define ARX_ROT8_BYTES   14,13,12,15, 10,9,8,11, 6,5,4,7, 2,1,0,3
+#define ARX_ROT16_BYTES  13,12,15,14, 9,8,11,10, 5,4,7,6, 1,0,3,2
+#define ARX_ROT24_BYTES  12,15,14,13, 8,11,10,9, 4,7,6,5, 0,3,2,1
+#define SSSE3_ROTL8(v)   _mm_shuffle_epi8(v, _mm_set_epi8(ARX_ROT8_BYTES))
+#define SSSE3_ROTL16(v)  _mm_shuffle_epi8(v, _mm_set_epi8(ARX_ROT16_BYTES))
+#define SSSE3_ROTL24(v)  _mm_shuffle_epi8(v, _mm_set_epi8(ARX_ROT24_BYTES))
+#define AVX2_ROTL8(v)    _mm256_shuffle_epi8(v, _mm256_set_epi8(ARX_ROT8_BYTES, ARX_ROT8_BYTES))
+#define AVX2_ROTL16(v)   _mm256_shuffle_epi8(v, _mm256_set_epi8(ARX_ROT16_BYTES, ARX_ROT16_BYTES))
+#define AVX2_ROTL24(v)   _mm256_shuffle_epi8(v, _mm256_set_epi8(ARX_ROT24_BYTES, ARX_ROT24_BYTES))
+
+// AVX512_ROTL(v, n): vprold, any constant amount in one instruction
+#define AVX512_ROTL(v, n) _mm512_rol_epi32(v, n)
+
+// SSE_TRANSPOSE4(a, b, c, d):
+//   4x4 transpose of 32-bit words: on entry vector w holds word w of
+//   blocks 0..3, on exit vector k holds four consecutive words of block k.
+//   Like every transpose here it is its own inverse, so the same macro
+//   turns 16-byte rows loaded from four blocks into word vectors.
+#define SSE_TRANSPOSE4(a, b, c, d)                  \
+    do {                                            \
+        __m128i t0_ = _mm_unpacklo_epi32(a, b);     \
+        __m128i t1_ = _mm_unpacklo_epi32(c, d);     \
+        __m128i t2_ = _mm_unpackhi_epi32(a, b);     \
+        __m128i t3_ = _mm_unpackhi_epi32(c, d);     \
+        a = _mm_unpacklo_epi64(t0_, t1_);           \
+        b = _mm_unpackhi_epi64(t0_, t1_);           \
+        c = _mm_unpacklo_epi64(t2_, t3_);           \
+        d = _mm_unpackhi_epi64(t2_, t3_);           \
+    } while (0)
+
+// AVX2_TRANSPOSE4(a, b, c, d):
+//   SSE_TRANSPOSE4 applied to both 128-bit halves: afterwards vector k
+//   holds four words of block k in the low half and of block k+4 in the
+//   high half.
+#define AVX2_TRANSPOSE4(a, b, c, d)                 \
+    do {                                            \
+        __m256i t0_ = _mm256_unpacklo_epi32(a, b);  \
+        __m256i t1_ = _mm256_unpacklo_epi32(c, d);  \
+        __m256i t2_ = _mm256_unpackhi_epi32(a, b);  \
+        __m256i t3_ = _mm256_unpackhi_epi32(c, d);  \
+        a = _mm256_unpacklo_epi64(t0_, t1_);        \
+        b = _mm256_unpackhi_epi64(t0_, t1_);        \
+        c = _mm256_unpacklo_epi64(t2_, t3_);        \
+        d = _mm256_unpackhi_epi64(t2_, t3_);        \
+    } while (0)
+
+// AVX512_TRANSPOSE4(a, b, c, d): SSE_TRANSPOSE4 on all four 128-bit lanes.
+#define AVX512_TRANSPOSE4(a, b, c, d)               \
+    do {                                            \
+        __m512i t0_ = _mm512_unpacklo_epi32(a, b);  \
+        __m512i t1_ = _mm512_unpacklo_epi32(c, d);  \
+        __m512i t2_ = _mm512_unpackhi_epi32(a, b);  \
+        __m512i t3_ = _mm512_unpackhi_epi32(c, d);  \
+        a = _mm512_unpacklo_epi64(t0_, t1_);        \
+        b = _mm512_unpackhi_epi64(t0_, t1_);        \
+        c = _mm512_unpacklo_epi64(t2_, t3_);        \
+        d = _mm512_unpackhi_epi64(t2_, t3_);        \
+    } while (0)
+
+// AVX512_TRANSPOSE128(a, b, c, d):
+//   4x4 transpose of 128-bit lanes. On entry vector g holds word group g
+//   (16 bytes) of blocks k, k+4, k+8, k+12; on exit vector L holds the full
+//   64-byte block k+4L.
+#define AVX512_TRANSPOSE128(a, b, c, d)                     \
+    do {                                                    \
+        __m512i t0_ = _mm512_shuffle_i32x4(a, b, 0x44);     \
+        __m512i t1_ = _mm512_shuffle_i32x4(c, d, 0x44);     \
+        __m512i t2_ = _mm512_shuffle_i32x4(a, b, 0xEE);     \
+        __m512i t3_ = _mm512_shuffle_i32x4(c, d, 0xEE);     \
+        a = _mm512_shuffle_i32x4(t0_, t1_, 0x88);           \
+        b = _mm512_shuffle_i32x4(t0_, t1_, 0xDD);           \
+        c = _mm512_shuffle_i32x4(t2_, t3_, 0x88);           \
+        d = _mm512_shuffle_i32x4(t2_, t3_, 0xDD);           \
+    } while (0)
+#endif
+
+// ARX state vectors
+//   The stream kernels keep the 16-word state of N blocks as 16 vectors:
+//   x[w] holds word w of every block, one block per lane. A cipher plugs
+//   in its rounds (its quarter round over x[]) and the word holding its
+//   block counter; the rest is shared, one pair per ISA:
+//     arx_<isa>_init(s, state, ctr, ctr64)
+//       s[w] = state[w] in every lane, and lane k of word ctr counts k
+//       blocks further. With ctr64 lanes whose low word wrapped carry into
+//       word ctr+1.
+//     arx_<isa>_xor_out(out, in, x, s)
+//       Feed-forward x += s, transpose x into block rows and XOR the N
+//       blocks (64*N bytes) of in into out, unaligned.
+//   A kernel pass is then init, copy s to x, rounds, xor_out and
+//   arx_ctr_add(state, ctr, N, ctr64); ARX_KERNEL writes that loop.
+//
+// ARX_KERNEL(name, isa, vec, blocks, attr, DOUBLEROUND, QR, CTR_WORD, tail):
+//   Define the template name##_tmpl(out, in, len, state, ctr64, rounds):
+//   passes of `blocks` blocks in 16 `vec` state vectors of arx_<isa>_*,
+//   with the cipher's DOUBLEROUND(QR, x) `rounds`/2 times in between and
+//   the block counter in word CTR_WORD(ctr64). The rest (< blocks blocks)
+//   goes to tail(out, in, len, state, ctr64, rounds). attr carries the
+//   target attribute.
+#define ARX_KERNEL(name, isa, vec, blocks, attr, DOUBLEROUND, QR, CTR_WORD, tail) \
+    attr static inline __attribute__((always_inline))                       \
+    void name##_tmpl(uint8_t *out, const uint8_t *in, size_t len,           \
+                     uint32_t state[16], int ctr64, int rounds) {           \
+        size_t off = 0;                                                     \
+        while (len >= 64 * (size_t)(blocks)) {                              \
+            vec x[16], s[16];                                               \
+            arx_##isa##_init(s, state, CTR_WORD(ctr64), ctr64);             \
+            for (int w = 0; w < 16; w++) {                                  \
+                x[w] = s[w];                                                \
+            }                                                               \
+            ARX_UNROLL                                                      \
+            for (int i = 0; i < rounds; i += 2) {                           \
+                DOUBLEROUND(QR, x);                                         \
+            }                                                               \
+            arx_##isa##_xor_out(out + off, in + off, x, s);                 \
+            off += 64 * (size_t)(blocks);                                   \
+            len -= 64 * (size_t)(blocks);                                   \
+            arx_ctr_add(state, CTR_WORD(ctr64), (blocks), ctr64);           \
+        }                                                                   \
+        if (len > 0) {                                                      \
+            tail(out + off, in + off, len, state, ctr64, rounds);           \
+        }                                                                   \
+    }
+
+#if HAVE_NEON
+static inline __attribute__((always_inline))
+void arx_neon_init(uint32x4_t s[16], const uint32_t state[16], int ctr, int ctr64) {
+    const uint32x4_t lanes = { 0, 1, 2, 3 };
+    for (int w = 0; w < 16; w++) {
+        s[w] = vdupq_n_u32(state[w]);
+    }
+    s[ctr] = vaddq_u32(s[ctr], lanes);
+    if (ctr64) {
+        // lanes whose low word wrapped carry (mask is all-ones = -1)
+        s[ctr + 1] = vsubq_u32(s[ctr + 1], vcltq_u32(s[ctr], vdupq_n_u32(state[ctr])));
+    }
+}
+
+// Words are little-endian on every target this path is built for, so the
+// vectors are reinterpreted as bytes as they are
+static inline __attribute__((always_inline))
+void arx_neon_xor_out(uint8_t *out, const uint8_t *in,
+                      uint32x4_t x[16], const uint32x4_t s[16]) {
+    for (int w = 0; w < 16; w++) {
+        x[w] = vaddq_u32(x[w], s[w]);
+    }
+    // x[4g+k] = bytes 16g..16g+15 of block k
+    for (int g = 0; g < 16; g += 4) {
+        NEON_TRANSPOSE4(x[g], x[g + 1], x[g + 2], x[g + 3]);
+    }
+    for (int k = 0; k < 4; k++) {
+        for (int g = 0; g < 4; g++) {
+            uint8x16_t m = vld1q_u8(in + k*64 + g*16);
+            vst1q_u8(out + k*64 + g*16, veorq_u8(m, vreinterpretq_u8_u32(x[4*g + k])));
+        }
+    }
+}
+#endif
+
+#if HAVE_X86
+static inline __attribute__((target("sse2"), always_inline))
+void arx_sse_init(__m128i s[16], const uint32_t state[16], int ctr, int ctr64) {
+    for (int w = 0; w < 16; w++) {
+        s[w] = _mm_set1_epi32((int)state[w]);
+    }
+    s[ctr] = _mm_add_epi32(s[ctr], _mm_set_epi32(3, 2, 1, 0));
+    if (ctr64) {
+        // unsigned lane < counter via the sign-flip trick, carry = -mask
+        const __m128i sign = _mm_set1_epi32((int)0x80000000u);
+        __m128i wrap = _mm_cmpgt_epi32(_mm_xor_si128(_mm_set1_epi32((int)state[ctr]), sign),
+                                       _mm_xor_si128(s[ctr], sign));
+        s[ctr + 1] = _mm_sub_epi32(s[ctr + 1], wrap);
+    }
+}
+
+static inline __attribute__((target("sse2"), always_inline))
+void arx_sse_xor_out(uint8_t *out, const uint8_t *in,
+                     __m128i x[16], const __m128i s[16]) {
+    for (int w = 0; w < 16; w++) {
+        x[w] = _mm_add_epi32(x[w], s[w]);
+    }
+    // x[4g+k] = bytes 16g..16g+15 of block k
+    for (int g = 0; g < 16; g += 4) {
+        SSE_TRANSPOSE4(x[g], x[g + 1], x[g + 2], x[g + 3]);
+    }
+    for (int k = 0; k < 4; k++) {
+        for (int g = 0; g < 4; g++) {
+            __m128i m = _mm_loadu_si128((const __m128i *)(in + k*64 + g*16));
+            _mm_storeu_si128((__m128i *)(out + k*64 + g*16), _mm_xor_si128(m, x[4*g + k]));
+        }
+    }
+}
+
+static inline __attribute__((target("avx2"), always_inline))
+void arx_avx2_init(__m256i s[16], const uint32_t state[16], int ctr, int ctr64) {
+    for (int w = 0; w < 16; w++) {
+        s[w] = _mm256_set1_epi32((int)state[w]);
+    }
+    s[ctr] = _mm256_add_epi32(s[ctr], _mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+    if (ctr64) {
+        const __m256i sign = _mm256_set1_epi32((int)0x80000000u);
+        __m256i wrap = _mm256_cmpgt_epi32(_mm256_xor_si256(_mm256_set1_epi32((int)state[ctr]), sign),
+                                          _mm256_xor_si256(s[ctr], sign));
+        s[ctr + 1] = _mm256_sub_epi32(s[ctr + 1], wrap);
+    }
+}
+
+static inline __attribute__((target("avx2"), always_inline))
+void arx_avx2_xor_out(uint8_t *out, const uint8_t *in,
+                      __m256i x[16], const __m256i s[16]) {
+    for (int w = 0; w < 16; w++) {
+        x[w] = _mm256_add_epi32(x[w], s[w]);
+    }
+    // x[4g+k]: word group g of block k (low half) and block k+4 (high half)
+    for (int g = 0; g < 16; g += 4) {
+        AVX2_TRANSPOSE4(x[g], x[g + 1], x[g + 2], x[g + 3]);
+    }
+    // vperm2i128 joins the groups into 32-byte rows of one block
+    for (int k = 0; k < 4; k++) {
+        __m256i r0 = _mm256_permute2x128_si256(x[k],     x[4 + k],  0x20); // block k,   bytes  0..31
+        __m256i r1 = _mm256_permute2x128_si256(x[8 + k], x[12 + k], 0x20); // block k,   bytes 32..63
+        __m256i r2 = _mm256_permute2x128_si256(x[k],     x[4 + k],  0x31); // block k+4, bytes  0..31
+        __m256i r3 = _mm256_permute2x128_si256(x[8 + k], x[12 + k], 0x31); // block k+4, bytes 32..63
+        _mm256_storeu_si256((__m256i *)(out + k*64),
+            _mm256_xor_si256(r0, _mm256_loadu_si256((const __m256i *)(in + k*64))));
+        _mm256_storeu_si256((__m256i *)(out + k*64 + 32),
+            _mm256_xor_si256(r1, _mm256_loadu_si256((const __m256i *)(in + k*64 + 32))));
+        _mm256_storeu_si256((__m256i *)(out + (k+4)*64),
+            _mm256_xor_si256(r2, _mm256_loadu_si256((const __m256i *)(in + (k+4)*64))));
+        _mm256_storeu_si256((__m256i *)(out + (k+4)*64 + 32),
+            _mm256_xor_si256(r3, _mm256_loadu_si256((const __m256i *)(in + (k+4)*64 + 32))));
+    }
+}
+
+static inline __attribute__((target("avx512f"), always_inline))
+void arx_avx512_init(__m512i s[16], const uint32_t state[16], int ctr, int ctr64) {
+    for (int w = 0; w < 16; w++) {
+        s[w] = _mm512_set1_epi32((int)state[w]);
+    }
+    s[ctr] = _mm512_add_epi32(s[ctr], _mm512_set_epi32(15, 14, 13, 12, 11, 10, 9, 8,
+                                                       7, 6, 5, 4, 3, 2, 1, 0));
+    if (ctr64) {
+        __mmask16 wrap = _mm512_cmplt_epu32_mask(s[ctr], _mm512_set1_epi32((int)state[ctr]));
+        s[ctr + 1] = _mm512_mask_add_epi32(s[ctr + 1], wrap, s[ctr + 1], _mm512_set1_epi32(1));
+    }
+}
+
+static inline __attribute__((target("avx512f"), always_inline))
+void arx_avx512_xor_out(uint8_t *out, const uint8_t *in,
+                        __m512i x[16], const __m512i s[16]) {
+    for (int w = 0; w < 16; w++) {
+        x[w] = _mm512_add_epi32(x[w], s[w]);
+    }
+    // Words within each 128-bit lane, then 128-bit lanes across vectors:
+    // afterwards x[k] is the whole block k
+    for (int g = 0; g < 16; g += 4) {
+        AVX512_TRANSPOSE4(x[g], x[g + 1], x[g + 2], x[g + 3]);
+    }
+    for (int k = 0; k < 4; k++) {
+        AVX512_TRANSPOSE128(x[k], x[4 + k], x[8 + k], x[12 + k]);   // blocks k, k+4, k+8, k+12
+    }
+    for (int k = 0; k < 16; k++) {
+        __m512i m = _mm512_loadu_si512((const void *)(in + k*64));
+        _mm512_storeu_si512((void *)(out + k*64), _mm512_xor_si512(m, x[k]));
+    }
+}
+#endif
+
+#endif
@@ -0,0 +1,837 @@
+// blake3.c
+// BLAKE3 hash on the ARX machinery of chacha20_simd.c.
+//
+//   blake3_compress: the compression function. Its G is the ChaCha
+//     quarter round (rotates 16/12/8/7, right instead of left) with two
+//     message words added in, run for 7 rounds over a 16-word state
+//   b3_many_ssse3 / _avx2 / _avx512 / _neon: hash 4, 8 or 16 inputs at
+//     once, one input per SIMD lane, with the rows of each message block
+//     turned into word vectors by the transposes of arx_simd.h
+//   blake3_hasher_*: incremental hashing; whole subtrees of the input go
+//     through the SIMD kernels a batch of chunks at a time, then their
+//     parent nodes likewise
+//   blake3_hasher_update_mt: the same, with the two halves of each large
+//     subtree hashed on separate threads
+//
+// Build: gcc -O3 -std=c11 -pthread -c blake3.c
+
+#define _POSIX_C_SOURCE 200112L   // sysconf(_SC_NPROCESSORS_ONLN)
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "blake3.h"
+#include "arx_simd.h"
+
+// Domain separation flags, word 15 of the state
+enum {
+    CHUNK_START         = 1 << 0,
+    CHUNK_END           = 1 << 1,
+    PARENT              = 1 << 2,
+    ROOT                = 1 << 3,
+    KEYED_HASH          = 1 << 4,
+    DERIVE_KEY_CONTEXT  = 1 << 5,
+    DERIVE_KEY_MATERIAL = 1 << 6,
+};
+
+#define B3_MAX_LANES 16
+
+// Below this a subtree is not worth a thread of its own
+#ifndef BLAKE3_MT_MIN_LEN
+#define BLAKE3_MT_MIN_LEN ((size_t)1 << 20)
+#endif
+#define BLAKE3_MT_MAX_THREADS 256
+
+static const uint32_t B3_IV[8] = {
+    0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A,
+    0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19,
+};
+
+// Message word order of each round: round r applies the fixed permutation
+// (2,6,3,10,7,0,4,13,1,11,12,5,9,14,15,8) r times to 0..15
+static const uint8_t B3_SCHEDULE[7][16] = {
+    { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 },
+    { 2, 6, 3, 10, 7, 0, 4, 13, 1, 11, 12, 5, 9, 14, 15, 8 },
+    { 3, 4, 10, 12, 13, 2, 7, 14, 6, 5, 9, 0, 11, 15, 8, 1 },
+    { 10, 7, 12, 9, 14, 3, 13, 15, 4, 0, 11, 2, 5, 8, 1, 6 },
+    { 12, 13, 9, 11, 15, 10, 14, 8, 7, 2, 5, 3, 0, 1, 6, 4 },
+    { 9, 14, 11, 5, 8, 12, 15, 1, 13, 3, 0, 10, 2, 6, 4, 7 },
+    { 11, 15, 5, 0, 1, 9, 8, 6, 14, 10, 2, 12, 3, 4, 7, 13 },
+};
+
+// B3_UNROLL: the 7 rounds are unrolled so every schedule index is constant
+#if defined(__clang__)
+  #define B3_UNROLL _Pragma("unroll")
+#elif defined(__GNUC__)
+  #define B3_UNROLL _Pragma("GCC unroll 7")
+#else
+  #define B3_UNROLL
+#endif
+
+//B3_G(a, b, c, d, mx, my):
+//  ChaCha's QUARTERROUND with a message word added to a in each half and
+//  the rotates taken to the right.
+#define B3_G(a, b, c, d, mx, my)        \
+    do {                                \
+        a = a + b + (mx);               \
+        d = ROTR32(d ^ a, 16);          \
+        c = c + d;                      \
+        b = ROTR32(b ^ c, 12);          \
+        a = a + b + (my);               \
+        d = ROTR32(d ^ a, 8);           \
+        c = c + d;                      \
+        b = ROTR32(b ^ c, 7);           \
+    } while (0)
+
+//B3_ROUNDS(G, v, m):
+//  The 7 rounds on state v[16] with message m[16], G being the scalar or a
+//  vector G: columns, then diagonals, as in ChaCha.
+#define B3_ROUNDS(G, v, m)                                                      \
+    do {                                                                        \
+        B3_UNROLL                                                               \
+        for (int r_ = 0; r_ < 7; r_++) {                                        \
+            const uint8_t *s_ = B3_SCHEDULE[r_];                                \
+            G(v[0], v[4], v[8],  v[12], m[s_[0]],  m[s_[1]]);                   \
+            G(v[1], v[5], v[9],  v[13], m[s_[2]],  m[s_[3]]);                   \
+            G(v[2], v[6], v[10], v[14], m[s_[4]],  m[s_[5]]);                   \
+            G(v[3], v[7], v[11], v[15], m[s_[6]],  m[s_[7]]);                   \
+            G(v[0], v[5], v[10], v[15], m[s_[8]],  m[s_[9]]);                   \
+            G(v[1], v[6], v[11], v[12], m[s_[10]], m[s_[11]]);                  \
+            G(v[2], v[7], v[8],  v[13], m[s_[12]], m[s_[13]]);                  \
+            G(v[3], v[4], v[9],  v[14], m[s_[14]], m[s_[15]]);                  \
+        }                                                                       \
+    } while (0)
+
+// ===================== Scalar compression =====================
+
+// 7 rounds over cv | IV[0..3] | counter | block_len | flags, no output step
+static void b3_compress_state(uint32_t v[16], const uint32_t cv[8],
+                              const uint8_t block[64], uint8_t block_len,
+                              uint64_t counter, uint8_t flags) {
+    uint32_t m[16];
+    for (int i = 0; i < 16; i++) m[i] = load32_le(block + 4 * i);
+    for (int i = 0; i < 8; i++) v[i] = cv[i];
+    v[8] = B3_IV[0]; v[9] = B3_IV[1]; v[10] = B3_IV[2]; v[11] = B3_IV[3];
+    v[12] = (uint32_t)counter;
+    v[13] = (uint32_t)(counter >> 32);
+    v[14] = block_len;
+    v[15] = flags;
+    B3_ROUNDS(B3_G, v, m);
+}
+
+//blake3_compress(cv, block, block_len, counter, flags):
+//  New chaining value cv = v[0..7] ^ v[8..15], as used inside the tree.
+static void blake3_compress(uint32_t cv[8], const uint8_t block[64], uint8_t block_len,
+                            uint64_t counter, uint8_t flags) {
+    uint32_t v[16];
+    b3_compress_state(v, cv, block, block_len, counter, flags);
+    for (int i = 0; i < 8; i++) cv[i] = v[i] ^ v[i + 8];
+}
+
+// Extended output of the root node: 64 bytes for output block `counter`
+static void blake3_compress_xof(const uint32_t cv[8], const uint8_t block[64],
+                                uint8_t block_len, uint64_t counter, uint8_t flags,
+                                uint8_t out[64]) {
+    uint32_t v[16];
+    b3_compress_state(v, cv, block, block_len, counter, flags);
+    for (int i = 0; i < 8; i++) {
+        store32_le(out + 4 * i, v[i] ^ v[i + 8]);
+        store32_le(out + 32 + 4 * i, v[i + 8] ^ cv[i]);
+    }
+}
+
+// ===================== Many inputs at once =====================
+
+//b3_many_fn(in, blocks, key, counter, inc, flags, flags_start, flags_end, out):
+//  Hash `lanes` inputs of `blocks` 64-byte blocks each from chaining value
+//  key, writing one 32-byte chaining value per input to out. Input k uses
+//  counter + k*inc; flags_start / flags_end are added on the first / last
+//  block. Full chunks are 16 blocks with CHUNK_START/CHUNK_END, parent
+//  nodes a single block with counter 0 and no increment.
+typedef void (*b3_many_fn)(const uint8_t *const *in, size_t blocks, const uint32_t key[8],
+                           uint64_t counter, int inc, uint8_t flags,
+                           uint8_t flags_start, uint8_t flags_end, uint8_t *out);
+
+static void b3_counters(uint32_t lo[], uint32_t hi[], int lanes, uint64_t counter, int inc) {
+    for (int k = 0; k < lanes; k++) {
+        uint64_t c = counter + (inc ? (uint64_t)k : 0);
+        lo[k] = (uint32_t)c;
+        hi[k] = (uint32_t)(c >> 32);
+    }
+}
+
+static void b3_many_portable(const uint8_t *const *in, size_t blocks, const uint32_t key[8],
+                             uint64_t counter, int inc, uint8_t flags,
+                             uint8_t flags_start, uint8_t flags_end, uint8_t *out) {
+    uint32_t cv[8];
+    memcpy(cv, key, sizeof(cv));
+    uint8_t bflags = flags | flags_start;
+    for (size_t b = 0; b < blocks; b++) {
+        if (b + 1 == blocks) bflags |= flags_end;
+        blake3_compress(cv, in[0] + 64 * b, 64, counter, bflags);
+        bflags = flags;
+    }
+    (void)inc;
+    for (int i = 0; i < 8; i++) store32_le(out + 4 * i, cv[i]);
+}
+
+#if HAVE_NEON
+// NEON G: ROTR by 16/12/8/7 = ROTL by 16/20/24/25
+#define NEON_B3_G(a, b, c, d, mx, my)                                   \
+    do {                                                                \
+        a = vaddq_u32(vaddq_u32(a, b), mx);                             \
+        d = NEON_ROTL(veorq_u32(d, a), 16);                             \
+        c = vaddq_u32(c, d);                                            \
+        b = NEON_ROTL(veorq_u32(b, c), 20);                             \
+        a = vaddq_u32(vaddq_u32(a, b), my);                             \
+        d = NEON_ROTL(veorq_u32(d, a), 24);                             \
+        c = vaddq_u32(c, d);                                            \
+        b = NEON_ROTL(veorq_u32(b, c), 25);                             \
+    } while (0)
+
+//b3_many_neon(...):
+//  4 inputs per call. Each block is loaded as 16-byte rows of the four
+//  inputs and NEON_TRANSPOSE4 makes word vectors of them; the chaining
+//  values go back the same way.
+static void b3_many_neon(const uint8_t *const *in, size_t blocks, const uint32_t key[8],
+                         uint64_t counter, int inc, uint8_t flags,
+                         uint8_t flags_start, uint8_t flags_end, uint8_t *out) {
+    uint32_t lo[4], hi[4];
+    b3_counters(lo, hi, 4, counter, inc);
+    uint32x4_t h[8];
+    for (int i = 0; i < 8; i++) h[i] = vdupq_n_u32(key[i]);
+    uint8_t bflags = flags | flags_start;
+    for (size_t b = 0; b < blocks; b++) {
+        if (b + 1 == blocks) bflags |= flags_end;
+        uint32x4_t m[16], v[16];
+        for (int g = 0; g < 4; g++) {
+            for (int k = 0; k < 4; k++) {
+                m[4*g + k] = vreinterpretq_u32_u8(vld1q_u8(in[k] + 64*b + 16*g));
+            }
+            NEON_TRANSPOSE4(m[4*g], m[4*g + 1], m[4*g + 2], m[4*g + 3]);
+        }
+        for (int i = 0; i < 8; i++) v[i] = h[i];
+        for (int i = 0; i < 4; i++) v[8 + i] = vdupq_n_u32(B3_IV[i]);
+        v[12] = vld1q_u32(lo);
+        v[13] = vld1q_u32(hi);
+        v[14] = vdupq_n_u32(64);
+        v[15] = vdupq_n_u32(bflags);
+        B3_ROUNDS(NEON_B3_G, v, m);
+        for (int i = 0; i < 8; i++) h[i] = veorq_u32(v[i], v[i + 8]);
+        bflags = flags;
+    }
+    NEON_TRANSPOSE4(h[0], h[1], h[2], h[3]);
+    NEON_TRANSPOSE4(h[4], h[5], h[6], h[7]);
+    for (int k = 0; k < 4; k++) {
+        vst1q_u8(out + 32*k,      vreinterpretq_u8_u32(h[k]));
+        vst1q_u8(out + 32*k + 16, vreinterpretq_u8_u32(h[4 + k]));
+    }
+}
+#endif
+
+#if HAVE_X86
+// pshufb masks: ROTR 16 = ROTL 16 and ROTR 8 = ROTL 24 move whole bytes
+#define B3_SSE_ROR16  _mm_set_epi8(ARX_ROT16_BYTES)
+#define B3_SSE_ROR8   _mm_set_epi8(ARX_ROT24_BYTES)
+
+#define SSE_B3_G(a, b, c, d, mx, my)                                    \
+    do {                                                                \
+        a = _mm_add_epi32(_mm_add_epi32(a, b), mx);                     \
+        d = _mm_shuffle_epi8(_mm_xor_si128(d, a), ror16);               \
+        c = _mm_add_epi32(c, d);                                        \
+        b = SSE_ROTL(_mm_xor_si128(b, c), 20);                          \
+        a = _mm_add_epi32(_mm_add_epi32(a, b), my);                     \
+        d = _mm_shuffle_epi8(_mm_xor_si128(d, a), ror8);                \
+        c = _mm_add_epi32(c, d);                                        \
+        b = SSE_ROTL(_mm_xor_si128(b, c), 25);                          \
+    } while (0)
+
+//b3_many_ssse3(...):
+//  x86 counterpart of b3_many_neon, 4 inputs per call.
+static __attribute__((target("ssse3")))
+void b3_many_ssse3(const uint8_t *const *in, size_t blocks, const uint32_t key[8],
+                   uint64_t counter, int inc, uint8_t flags,
+                   uint8_t flags_start, uint8_t flags_end, uint8_t *out) {
+    const __m128i ror16 = B3_SSE_ROR16, ror8 = B3_SSE_ROR8;
+    uint32_t lo[4], hi[4];
+    b3_counters(lo, hi, 4, counter, inc);
+    __m128i h[8];
+    for (int i = 0; i < 8; i++) h[i] = _mm_set1_epi32((int)key[i]);
+    uint8_t bflags = flags | flags_start;
+    for (size_t b = 0; b < blocks; b++) {
+        if (b + 1 == blocks) bflags |= flags_end;
+        __m128i m[16], v[16];
+        for (int g = 0; g < 4; g++) {
+            for (int k = 0; k < 4; k++) {
+                m[4*g + k] = _mm_loadu_si128((const __m128i *)(in[k] + 64*b + 16*g));
+            }
+            SSE_TRANSPOSE4(m[4*g], m[4*g + 1], m[4*g + 2], m[4*g + 3]);
+        }
+        for (int i = 0; i < 8; i++) v[i] = h[i];
+        for (int i = 0; i < 4; i++) v[8 + i] = _mm_set1_epi32((int)B3_IV[i]);
+        v[12] = _mm_loadu_si128((const __m128i *)lo);
+        v[13] = _mm_loadu_si128((const __m128i *)hi);
+        v[14] = _mm_set1_epi32(64);
+        v[15] = _mm_set1_epi32(bflags);
+        B3_ROUNDS(SSE_B3_G, v, m);
+        for (int i = 0; i < 8; i++) h[i] = _mm_xor_si128(v[i], v[i + 8]);
+        bflags = flags;
+    }
+    SSE_TRANSPOSE4(h[0], h[1], h[2], h[3]);
+    SSE_TRANSPOSE4(h[4], h[5], h[6], h[7]);
+    for (int k = 0; k < 4; k++) {
+        _mm_storeu_si128((__m128i *)(out + 32*k),      h[k]);
+        _mm_storeu_si128((__m128i *)(out + 32*k + 16), h[4 + k]);
+    }
+}
+
+#define AVX2_B3_G(a, b, c, d, mx, my)                                   \
+    do {                                                                \
+        a = _mm256_add_epi32(_mm256_add_epi32(a, b), mx);               \
+        d = _mm256_shuffle_epi8(_mm256_xor_si256(d, a), ror16);         \
+        c = _mm256_add_epi32(c, d);                                     \
+        b = AVX2_ROTL(_mm256_xor_si256(b, c), 20);                      \
+        a = _mm256_add_epi32(_mm256_add_epi32(a, b), my);               \
+        d = _mm256_shuffle_epi8(_mm256_xor_si256(d, a), ror8);          \
+        c = _mm256_add_epi32(c, d);                                     \
+        b = AVX2_ROTL(_mm256_xor_si256(b, c), 25);                      \
+    } while (0)
+
+//b3_many_avx2(...):
+//  8 inputs per call. Row k of a word group holds input k in the low half
+//  and input k+4 in the high half, so AVX2_TRANSPOSE4 yields word vectors
+//  in lane order 0..7; vperm2i128 splits the chaining values back up.
+static __attribute__((target("avx2")))
+void b3_many_avx2(const uint8_t *const *in, size_t blocks, const uint32_t key[8],
+                  uint64_t counter, int inc, uint8_t flags,
+                  uint8_t flags_start, uint8_t flags_end, uint8_t *out) {
+    const __m256i ror16 = _mm256_broadcastsi128_si256(B3_SSE_ROR16);
+    const __m256i ror8  = _mm256_broadcastsi128_si256(B3_SSE_ROR8);
+    uint32_t lo[8], hi[8];
+    b3_counters(lo, hi, 8, counter, inc);
+    __m256i h[8];
+    for (int i = 0; i < 8; i++) h[i] = _mm256_set1_epi32((int)key[i]);
+    uint8_t bflags = flags | flags_start;
+    for (size_t b = 0; b < blocks; b++) {
+        if (b + 1 == blocks) bflags |= flags_end;
+        __m256i m[16], v[16];
+        for (int g = 0; g < 4; g++) {
+            for (int k = 0; k < 4; k++) {
+                __m128i l = _mm_loadu_si128((const __m128i *)(in[k] + 64*b + 16*g));
+                __m128i u = _mm_loadu_si128((const __m128i *)(in[k + 4] + 64*b + 16*g));
+                m[4*g + k] = _mm256_inserti128_si256(_mm256_castsi128_si256(l), u, 1);
+            }
+            AVX2_TRANSPOSE4(m[4*g], m[4*g + 1], m[4*g + 2], m[4*g + 3]);
+        }
+        for (int i = 0; i < 8; i++) v[i] = h[i];
+        for (int i = 0; i < 4; i++) v[8 + i] = _mm256_set1_epi32((int)B3_IV[i]);
+        v[12] = _mm256_loadu_si256((const __m256i *)lo);
+        v[13] = _mm256_loadu_si256((const __m256i *)hi);
+        v[14] = _mm256_set1_epi32(64);
+        v[15] = _mm256_set1_epi32(bflags);
+        B3_ROUNDS(AVX2_B3_G, v, m);
+        for (int i = 0; i < 8; i++) h[i] = _mm256_xor_si256(v[i], v[i + 8]);
+        bflags = flags;
+    }
+    AVX2_TRANSPOSE4(h[0], h[1], h[2], h[3]);
+    AVX2_TRANSPOSE4(h[4], h[5], h[6], h[7]);
+    for (int k = 0; k < 4; k++) {
+        _mm256_storeu_si256((__m256i *)(out + 32*k),
+                            _mm256_permute2x128_si256(h[k], h[4 + k], 0x20));
+        _mm256_storeu_si256((__m256i *)(out + 32*(k + 4)),
+                            _mm256_permute2x128_si256(h[k], h[4 + k], 0x31));
+    }
+}
+
+#define AVX512_B3_G(a, b, c, d, mx, my)                                 \
+    do {                                                                \
+        a = _mm512_add_epi32(_mm512_add_epi32(a, b), mx);               \
+        d = _mm512_ror_epi32(_mm512_xor_si512(d, a), 16);               \
+        c = _mm512_add_epi32(c, d);                                     \
+        b = _mm512_ror_epi32(_mm512_xor_si512(b, c), 12);               \
+        a = _mm512_add_epi32(_mm512_add_epi32(a, b), my);               \
+        d = _mm512_ror_epi32(_mm512_xor_si512(d, a), 8);                \
+        c = _mm512_add_epi32(c, d);                                     \
+        b = _mm512_ror_epi32(_mm512_xor_si512(b, c), 7);                \
+    } while (0)
+
+//b3_many_avx512(...):
+//  16 inputs per call. Each block of each input is one zmm load; the
+//  ChaCha output transpose run backwards (AVX512_TRANSPOSE128, then
+//  AVX512_TRANSPOSE4) turns the 16 rows into the 16 message word vectors.
+static __attribute__((target("avx512f")))
+void b3_many_avx512(const uint8_t *const *in, size_t blocks, const uint32_t key[8],
+                    uint64_t counter, int inc, uint8_t flags,
+                    uint8_t flags_start, uint8_t flags_end, uint8_t *out) {
+    uint32_t lo[16], hi[16];
+    b3_counters(lo, hi, 16, counter, inc);
+    __m512i h[8];
+    for (int i = 0; i < 8; i++) h[i] = _mm512_set1_epi32((int)key[i]);
+    uint8_t bflags = flags | flags_start;
+    for (size_t b = 0; b < blocks; b++) {
+        if (b + 1 == blocks) bflags |= flags_end;
+        __m512i m[16], v[16];
+        for (int k = 0; k < 16; k++) {
+            m[k] = _mm512_loadu_si512((const void *)(in[k] + 64*b));
+        }
+        for (int k = 0; k < 4; k++) {
+            AVX512_TRANSPOSE128(m[k], m[k + 4], m[k + 8], m[k + 12]);
+        }
+        for (int g = 0; g < 4; g++) {
+            AVX512_TRANSPOSE4(m[4*g], m[4*g + 1], m[4*g + 2], m[4*g + 3]);
+        }
+        for (int i = 0; i < 8; i++) v[i] = h[i];
+        for (int i = 0; i < 4; i++) v[8 + i] = _mm512_set1_epi32((int)B3_IV[i]);
+        v[12] = _mm512_loadu_si512((const void *)lo);
+        v[13] = _mm512_loadu_si512((const void *)hi);
+        v[14] = _mm512_set1_epi32(64);
+        v[15] = _mm512_set1_epi32(bflags);
+        B3_ROUNDS(AVX512_B3_G, v, m);
+        for (int i = 0; i < 8; i++) h[i] = _mm512_xor_si512(v[i], v[i + 8]);
+        bflags = flags;
+    }
+    // 128-bit lane j of h[k] / h[4+k] now holds words 0..3 / 4..7 of input 4j+k
+    AVX512_TRANSPOSE4(h[0], h[1], h[2], h[3]);
+    AVX512_TRANSPOSE4(h[4], h[5], h[6], h[7]);
+    for (int k = 0; k < 4; k++) {
+        __m128i l0 = _mm512_extracti32x4_epi32(h[k], 0), u0 = _mm512_extracti32x4_epi32(h[4 + k], 0);
+        __m128i l1 = _mm512_extracti32x4_epi32(h[k], 1), u1 = _mm512_extracti32x4_epi32(h[4 + k], 1);
+        __m128i l2 = _mm512_extracti32x4_epi32(h[k], 2), u2 = _mm512_extracti32x4_epi32(h[4 + k], 2);
+        __m128i l3 = _mm512_extracti32x4_epi32(h[k], 3), u3 = _mm512_extracti32x4_epi32(h[4 + k], 3);
+        _mm_storeu_si128((__m128i *)(out + 32*k),             l0);
+        _mm_storeu_si128((__m128i *)(out + 32*k + 16),        u0);
+        _mm_storeu_si128((__m128i *)(out + 32*(k + 4)),       l1);
+        _mm_storeu_si128((__m128i *)(out + 32*(k + 4) + 16),  u1);
+        _mm_storeu_si128((__m128i *)(out + 32*(k + 8)),       l2);
+        _mm_storeu_si128((__m128i *)(out + 32*(k + 8) + 16),  u2);
+        _mm_storeu_si128((__m128i *)(out + 32*(k + 12)),      l3);
+        _mm_storeu_si128((__m128i *)(out + 32*(k + 12) + 16), u3);
+    }
+}
+#endif
+
+//b3_simd_degree() / b3_many_kernel():
+//  Widest kernel this CPU runs and its lane count, detected once. AVX-512
+//  only ever gets batches of 16 chunks (16 KiB), the same length from
+//  which chacha20_xor_best switches to it.
+static int b3_lanes = 0;
+static b3_many_fn b3_kernel = b3_many_portable;
+
+static int b3_simd_degree(void) {
+    if (b3_lanes == 0) {
+        int lanes = 1;
+        b3_many_fn fn = b3_many_portable;
+#if HAVE_NEON
+        lanes = 4;
+        fn = b3_many_neon;
+#elif HAVE_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("ssse3"))   { lanes = 4;  fn = b3_many_ssse3; }
+        if (__builtin_cpu_supports("avx2"))    { lanes = 8;  fn = b3_many_avx2; }
+        if (lanes == 8 && __builtin_cpu_supports("avx512f")) { lanes = 16; fn = b3_many_avx512; }
+#endif
+        b3_kernel = fn;
+        b3_lanes = lanes;
+    }
+    return b3_lanes;
+}
+
+//b3_hash_many(in, n, blocks, key, counter, inc, flags, flags_start, flags_end, out):
+//  Any number of inputs: full SIMD batches first, the rest one at a time.
+static void b3_hash_many(const uint8_t *const *in, size_t n, size_t blocks,
+                         const uint32_t key[8], uint64_t counter, int inc, uint8_t flags,
+                         uint8_t flags_start, uint8_t flags_end, uint8_t *out) {
+    size_t lanes = (size_t)b3_simd_degree();
+    while (lanes > 1 && n >= lanes) {
+        b3_kernel(in, blocks, key, counter, inc, flags, flags_start, flags_end, out);
+        in += lanes;
+        n -= lanes;
+        if (inc) counter += lanes;
+        out += lanes * BLAKE3_OUT_LEN;
+    }
+    while (n > 0) {
+        b3_many_portable(in, blocks, key, counter, inc, flags, flags_start, flags_end, out);
+        in++;
+        n--;
+        if (inc) counter++;
+        out += BLAKE3_OUT_LEN;
+    }
+}
+
+// ===================== Chunk state =====================
+
+static void b3_chunk_reset(blake3_hasher *h, uint64_t chunk_counter) {
+    memcpy(h->cv, h->key, sizeof(h->cv));
+    h->chunk_counter = chunk_counter;
+    memset(h->buf, 0, sizeof(h->buf));
+    h->buf_len = 0;
+    h->blocks_compressed = 0;
+}
+
+static size_t b3_chunk_len(const blake3_hasher *h) {
+    return (size_t)h->blocks_compressed * BLAKE3_BLOCK_LEN + h->buf_len;
+}
+
+static uint8_t b3_chunk_start_flag(const blake3_hasher *h) {
+    return h->blocks_compressed == 0 ? CHUNK_START : 0;
+}
+
+// The last block of a chunk stays buffered until more input proves it is
+// not the last one, so that it can still get CHUNK_END (and ROOT)
+static void b3_chunk_update(blake3_hasher *h, const uint8_t *in, size_t len) {
+    while (len > 0) {
+        if (h->buf_len == BLAKE3_BLOCK_LEN) {
+            blake3_compress(h->cv, h->buf, BLAKE3_BLOCK_LEN, h->chunk_counter,
+                            h->flags | b3_chunk_start_flag(h));
+            h->blocks_compressed++;
+            h->buf_len = 0;
+            memset(h->buf, 0, sizeof(h->buf));
+        }
+        size_t take = BLAKE3_BLOCK_LEN - h->buf_len;
+        if (take > len) take = len;
+        memcpy(h->buf + h->buf_len, in, take);
+        h->buf_len += (uint8_t)take;
+        in += take;
+        len -= take;
+    }
+}
+
+// A node not compressed yet: the root may still need its ROOT flag and
+// any number of output blocks, inner nodes only their chaining value
+typedef struct {
+    uint32_t cv[8];
+    uint8_t  block[BLAKE3_BLOCK_LEN];
+    uint8_t  block_len;
+    uint64_t counter;
+    uint8_t  flags;
+} b3_output;
+
+static b3_output b3_chunk_output(const blake3_hasher *h) {
+    b3_output o;
+    memcpy(o.cv, h->cv, sizeof(o.cv));
+    memcpy(o.block, h->buf, sizeof(o.block));
+    o.block_len = h->buf_len;
+    o.counter = h->chunk_counter;
+    o.flags = h->flags | b3_chunk_start_flag(h) | CHUNK_END;
+    return o;
+}
+
+static b3_output b3_parent_output(const uint8_t block[64], const uint32_t key[8], uint8_t flags) {
+    b3_output o;
+    memcpy(o.cv, key, sizeof(o.cv));
+    memcpy(o.block, block, sizeof(o.block));
+    o.block_len = BLAKE3_BLOCK_LEN;
+    o.counter = 0;
+    o.flags = flags | PARENT;
+    return o;
+}
+
+static void b3_output_cv(const b3_output *o, uint8_t cv[32]) {
+    uint32_t w[8];
+    memcpy(w, o->cv, sizeof(w));
+    blake3_compress(w, o->block, o->block_len, o->counter, o->flags);
+    for (int i = 0; i < 8; i++) store32_le(cv + 4 * i, w[i]);
+}
+
+static void b3_output_root(const b3_output *o, uint8_t *out, size_t out_len) {
+    uint8_t buf[64];
+    for (uint64_t blk = 0; out_len > 0; blk++) {
+        blake3_compress_xof(o->cv, o->block, o->block_len, blk, o->flags | ROOT, buf);
+        size_t n = out_len < 64 ? out_len : 64;
+        memcpy(out, buf, n);
+        out += n;
+        out_len -= n;
+    }
+}
+
+// ===================== Subtrees =====================
+
+// Largest power of two <= x (x > 0)
+static uint64_t b3_pow2_floor(uint64_t x) {
+    return (uint64_t)1 << (63 - __builtin_clzll(x));
+}
+
+// Bytes in the left subtree of an input of len > 1024 bytes: the largest
+// power-of-two number of whole chunks that leaves something on the right
+static size_t b3_left_len(size_t len) {
+    size_t full_chunks = (len - 1) / BLAKE3_CHUNK_LEN;
+    return (size_t)b3_pow2_floor(full_chunks) * BLAKE3_CHUNK_LEN;
+}
+
+// Chaining values of every chunk of in (at most one SIMD batch of chunks);
+// the last, possibly partial, chunk goes through the chunk state
+static size_t b3_chunks_parallel(const uint8_t *in, size_t len, const uint32_t key[8],
+                                 uint64_t chunk_counter, uint8_t flags, uint8_t *out) {
+    const uint8_t *ptrs[B3_MAX_LANES];
+    size_t n = 0;
+    while (len - n * BLAKE3_CHUNK_LEN >= BLAKE3_CHUNK_LEN) {
+        ptrs[n] = in + n * BLAKE3_CHUNK_LEN;
+        n++;
+    }
+    b3_hash_many(ptrs, n, BLAKE3_CHUNK_LEN / BLAKE3_BLOCK_LEN, key, chunk_counter, 1,
+                 flags, CHUNK_START, CHUNK_END, out);
+    size_t done = n * BLAKE3_CHUNK_LEN;
+    if (len > done) {
+        blake3_hasher tail;
+        memcpy(tail.key, key, sizeof(tail.key));
+        tail.flags = flags;
+        b3_chunk_reset(&tail, chunk_counter + n);
+        b3_chunk_update(&tail, in + done, len - done);
+        b3_output o = b3_chunk_output(&tail);
+        b3_output_cv(&o, out + n * BLAKE3_OUT_LEN);
+        return n + 1;
+    }
+    return n;
+}
+
+// Parents of pairs of chaining values; an odd one out moves up unchanged
+static size_t b3_parents_parallel(const uint8_t *cvs, size_t n, const uint32_t key[8],
+                                  uint8_t flags, uint8_t *out) {
+    const uint8_t *ptrs[B3_MAX_LANES];
+    size_t pairs = 0;
+    while (n - 2 * pairs >= 2) {
+        ptrs[pairs] = cvs + 2 * pairs * BLAKE3_OUT_LEN;
+        pairs++;
+    }
+    b3_hash_many(ptrs, pairs, 1, key, 0, 0, flags | PARENT, 0, 0, out);
+    if (n > 2 * pairs) {
+        memcpy(out + pairs * BLAKE3_OUT_LEN, cvs + 2 * pairs * BLAKE3_OUT_LEN, BLAKE3_OUT_LEN);
+        return pairs + 1;
+    }
+    return pairs;
+}
+
+typedef struct {
+    const uint8_t *in;
+    size_t len;
+    const uint32_t *key;
+    uint64_t chunk_counter;
+    uint8_t flags;
+    uint8_t *out;
+    unsigned threads;
+    size_t n_out;
+} b3_subtree_job;
+
+static void *b3_subtree_thread(void *arg);
+
+//b3_subtree_wide(job):
+//  Chaining values of the subtree over job->in, reduced to at most
+//  2*lanes of them (at least 2) by hashing parent levels as it returns.
+//  Left and right halves are independent; with threads to spare and a big
+//  enough input the left half runs on a new thread.
+static size_t b3_subtree_wide(const b3_subtree_job *job) {
+    size_t lanes = (size_t)b3_simd_degree();
+    if (job->len <= lanes * BLAKE3_CHUNK_LEN) {
+        return b3_chunks_parallel(job->in, job->len, job->key, job->chunk_counter,
+                                  job->flags, job->out);
+    }
+    size_t left_len = b3_left_len(job->len);
+    uint8_t cvs[2 * B3_MAX_LANES * BLAKE3_OUT_LEN];
+    size_t half = (lanes < 2 ? 2 : lanes) * BLAKE3_OUT_LEN;
+
+    b3_subtree_job left = {
+        job->in, left_len, job->key, job->chunk_counter, job->flags, cvs,
+        job->threads / 2, 0,
+    };
+    b3_subtree_job right = {
+        job->in + left_len, job->len - left_len, job->key,
+        job->chunk_counter + left_len / BLAKE3_CHUNK_LEN, job->flags, cvs + half,
+        job->threads - job->threads / 2, 0,
+    };
+    pthread_t tid;
+    int spawned = left.threads >= 1 && right.len >= BLAKE3_MT_MIN_LEN &&
+                  pthread_create(&tid, NULL, b3_subtree_thread, &left) == 0;
+    if (!spawned) {
+        left.threads = right.threads = job->threads;
+        left.n_out = b3_subtree_wide(&left);
+    }
+    right.n_out = b3_subtree_wide(&right);
+    if (spawned) pthread_join(tid, NULL);
+
+    // Only with one lane can a side return a single value; two are kept
+    // as they are so that the caller always gets a parent's worth
+    if (left.n_out == 1) {
+        memcpy(job->out, cvs, BLAKE3_OUT_LEN);
+        memcpy(job->out + BLAKE3_OUT_LEN, cvs + half, BLAKE3_OUT_LEN);
+        return 2;
+    }
+    // Close the gap between the left and right values, then one parent level
+    memmove(cvs + left.n_out * BLAKE3_OUT_LEN, cvs + half, right.n_out * BLAKE3_OUT_LEN);
+    return b3_parents_parallel(cvs, left.n_out + right.n_out, job->key, job->flags, job->out);
+}
+
+static void *b3_subtree_thread(void *arg) {
+    b3_subtree_job *job = arg;
+    job->n_out = b3_subtree_wide(job);
+    return NULL;
+}
+
+// The two chaining values below the root of a subtree of more than one
+// chunk; the caller pushes them onto its stack
+static void b3_subtree_to_parent(const uint8_t *in, size_t len, const uint32_t key[8],
+                                 uint64_t chunk_counter, uint8_t flags, unsigned threads,
+                                 uint8_t out[2 * BLAKE3_OUT_LEN]) {
+    uint8_t cvs[2 * B3_MAX_LANES * BLAKE3_OUT_LEN];
+    uint8_t tmp[B3_MAX_LANES * BLAKE3_OUT_LEN];
+    b3_subtree_job job = { in, len, key, chunk_counter, flags, cvs, threads, 0 };
+    size_t n = b3_subtree_wide(&job);
+    while (n > 2) {
+        n = b3_parents_parallel(cvs, n, key, flags, tmp);
+        memcpy(cvs, tmp, n * BLAKE3_OUT_LEN);
+    }
+    memcpy(out, cvs, 2 * BLAKE3_OUT_LEN);
+}
+
+// ===================== Hasher =====================
+
+// Merge finished subtrees: after total_chunks chunks the stack holds one
+// value per set bit of total_chunks. Merging lazily (only once more input
+// has arrived) keeps the last value on the stack, where finalize can
+// still make it the root.
+static void b3_merge_stack(blake3_hasher *h, uint64_t total_chunks) {
+    size_t post = (size_t)__builtin_popcountll(total_chunks);
+    while (h->cv_stack_len > post) {
+        uint8_t *pair = h->cv_stack + (h->cv_stack_len - 2) * BLAKE3_OUT_LEN;
+        b3_output o = b3_parent_output(pair, h->key, h->flags);
+        b3_output_cv(&o, pair);
+        h->cv_stack_len--;
+    }
+}
+
+static void b3_push_cv(blake3_hasher *h, const uint8_t cv[32], uint64_t chunk_counter) {
+    b3_merge_stack(h, chunk_counter);
+    memcpy(h->cv_stack + h->cv_stack_len * BLAKE3_OUT_LEN, cv, BLAKE3_OUT_LEN);
+    h->cv_stack_len++;
+}
+
+static void b3_init_base(blake3_hasher *h, const uint32_t key[8], uint8_t flags) {
+    memcpy(h->key, key, sizeof(h->key));
+    h->flags = flags;
+    h->cv_stack_len = 0;
+    b3_chunk_reset(h, 0);
+}
+
+void blake3_hasher_init(blake3_hasher *h) {
+    b3_init_base(h, B3_IV, 0);
+}
+
+void blake3_hasher_init_keyed(blake3_hasher *h, const uint8_t key[BLAKE3_KEY_LEN]) {
+    uint32_t k[8];
+    for (int i = 0; i < 8; i++) k[i] = load32_le(key + 4 * i);
+    b3_init_base(h, k, KEYED_HASH);
+}
+
+void blake3_hasher_init_derive_key(blake3_hasher *h, const char *context) {
+    blake3_hasher ctx;
+    uint8_t ctx_key[BLAKE3_KEY_LEN];
+    b3_init_base(&ctx, B3_IV, DERIVE_KEY_CONTEXT);
+    blake3_hasher_update(&ctx, context, strlen(context));
+    blake3_hasher_finalize(&ctx, ctx_key, sizeof(ctx_key));
+    uint32_t k[8];
+    for (int i = 0; i < 8; i++) k[i] = load32_le(ctx_key + 4 * i);
+    b3_init_base(h, k, DERIVE_KEY_MATERIAL);
+}
+
+//blake3_hasher_update_mt(h, in, len, threads):
+//  Top up the chunk in progress, then take the input in the largest
+//  power-of-two subtrees its position allows (a subtree of 2^k chunks
+//  must start at a multiple of 2^k chunks) and hash each one wide, in SIMD
+//  batches and on up to `threads` threads. The last chunk always ends up
+//  in the chunk state, unfinalized.
+void blake3_hasher_update_mt(blake3_hasher *h, const void *input, size_t len,
+                             unsigned threads) {
+    const uint8_t *in = input;
+    if (threads == 0) {
+        long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = ncpu > 0 ? (unsigned)ncpu : 1;
+    }
+    if (threads > BLAKE3_MT_MAX_THREADS) threads = BLAKE3_MT_MAX_THREADS;
+
+    if (b3_chunk_len(h) > 0) {
+        size_t take = BLAKE3_CHUNK_LEN - b3_chunk_len(h);
+        if (take > len) take = len;
+        b3_chunk_update(h, in, take);
+        in += take;
+        len -= take;
+        if (len == 0) return;
+        uint8_t cv[32];
+        b3_output o = b3_chunk_output(h);
+        b3_output_cv(&o, cv);
+        b3_push_cv(h, cv, h->chunk_counter);
+        b3_chunk_reset(h, h->chunk_counter + 1);
+    }
+
+    while (len > BLAKE3_CHUNK_LEN) {
+        uint64_t subtree_len = b3_pow2_floor(len);
+        uint64_t done = h->chunk_counter * BLAKE3_CHUNK_LEN;
+        while (((subtree_len - 1) & done) != 0) subtree_len /= 2;
+        uint64_t subtree_chunks = subtree_len / BLAKE3_CHUNK_LEN;
+        if (subtree_len <= BLAKE3_CHUNK_LEN) {
+            uint8_t cv[32];
+            b3_chunk_update(h, in, (size_t)subtree_len);
+            b3_output o = b3_chunk_output(h);
+            b3_output_cv(&o, cv);
+            b3_push_cv(h, cv, h->chunk_counter);
+            b3_chunk_reset(h, h->chunk_counter + 1);
+        } else {
+            uint8_t pair[2 * BLAKE3_OUT_LEN];
+            b3_subtree_to_parent(in, (size_t)subtree_len, h->key, h->chunk_counter,
+                                 h->flags, threads, pair);
+            b3_push_cv(h, pair, h->chunk_counter);
+            b3_push_cv(h, pair + BLAKE3_OUT_LEN, h->chunk_counter + subtree_chunks / 2);
+            b3_chunk_reset(h, h->chunk_counter + subtree_chunks);
+        }
+        in += subtree_len;
+        len -= (size_t)subtree_len;
+    }
+
+    if (len > 0) {
+        b3_chunk_update(h, in, len);
+        b3_merge_stack(h, h->chunk_counter);
+    }
+}
+
+void blake3_hasher_update(blake3_hasher *h, const void *in, size_t len) {
+    blake3_hasher_update_mt(h, in, len, 1);
+}
+
+//blake3_hasher_finalize(h, out, out_len):
+//  The chunk in progress (or, on a chunk boundary, the top two stack
+//  entries) is folded into the stack from the top; the last node is the
+//  root and produces out_len bytes of output.
+void blake3_hasher_finalize(const blake3_hasher *h, uint8_t *out, size_t out_len) {
+    if (out_len == 0) return;
+    if (h->cv_stack_len == 0) {
+        b3_output o = b3_chunk_output(h);
+        b3_output_root(&o, out, out_len);
+        return;
+    }
+    b3_output o;
+    size_t remaining;
+    if (b3_chunk_len(h) > 0) {
+        o = b3_chunk_output(h);
+        remaining = h->cv_stack_len;
+    } else {
+        o = b3_parent_output(h->cv_stack + (h->cv_stack_len - 2) * BLAKE3_OUT_LEN,
+                             h->key, h->flags);
+        remaining = h->cv_stack_len - 2;
+    }
+    while (remaining > 0) {
+        remaining--;
+        uint8_t block[64];
+        memcpy(block, h->cv_stack + remaining * BLAKE3_OUT_LEN, BLAKE3_OUT_LEN);
+        b3_output_cv(&o, block + BLAKE3_OUT_LEN);
+        o = b3_parent_output(block, h->key, h->flags);
+    }
+    b3_output_root(&o, out, out_len);
+}
+
+void blake3_hash(uint8_t *out, size_t out_len, const void *in, size_t len) {
+    blake3_hasher h;
+    blake3_hasher_init(&h);
+    blake3_hasher_update(&h, in, len);
+    blake3_hasher_finalize(&h, out, out_len);
+}
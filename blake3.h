@@ -0,0 +1,50 @@
+// blake3.h
+// BLAKE3 hashing (blake3.c): the ChaCha quarter round with a message
+// schedule as compression function, over a binary tree of 1 KiB chunks.
+// Regular, keyed and key-derivation modes, any output length.
+
+#ifndef BLAKE3_H
+#define BLAKE3_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define BLAKE3_OUT_LEN   32
+#define BLAKE3_KEY_LEN   32
+#define BLAKE3_BLOCK_LEN 64
+#define BLAKE3_CHUNK_LEN 1024
+#define BLAKE3_MAX_DEPTH 54     // 2^54 chunks = 2^64 bytes
+
+// Incremental hasher. Plain data: it may be copied, e.g. to finalize a
+// prefix and keep hashing. Treat the fields as private.
+typedef struct {
+    uint32_t key[8];
+    uint32_t cv[8];             // chaining value of the chunk in progress
+    uint64_t chunk_counter;     // index of that chunk
+    uint8_t  buf[BLAKE3_BLOCK_LEN];
+    uint8_t  buf_len;
+    uint8_t  blocks_compressed;
+    uint8_t  flags;
+    uint8_t  cv_stack_len;
+    uint8_t  cv_stack[(BLAKE3_MAX_DEPTH + 1) * BLAKE3_OUT_LEN];
+} blake3_hasher;
+
+void blake3_hasher_init(blake3_hasher *h);
+void blake3_hasher_init_keyed(blake3_hasher *h, const uint8_t key[BLAKE3_KEY_LEN]);
+// Key derivation: context is a hard-coded, globally unique string
+void blake3_hasher_init_derive_key(blake3_hasher *h, const char *context);
+
+void blake3_hasher_update(blake3_hasher *h, const void *in, size_t len);
+// Same result as blake3_hasher_update; large inputs are split into subtrees
+// hashed on up to `threads` threads (0 = one per online CPU)
+void blake3_hasher_update_mt(blake3_hasher *h, const void *in, size_t len,
+                             unsigned threads);
+
+// Write out_len bytes of output (32 is the standard digest; longer outputs
+// extend it). The hasher is not modified, so more input may follow.
+void blake3_hasher_finalize(const blake3_hasher *h, uint8_t *out, size_t out_len);
+
+// One-shot hash of in
+void blake3_hash(uint8_t *out, size_t out_len, const void *in, size_t len);
+
+#endif
@@ -2,11 +2,9 @@
 #include <stddef.h>
 #include <string.h>
 
-// rotate left 32-bit
-static inline uint32_t ROTL32(uint32_t x, int r) {
-    return (x << r) | (x >> (32 - r));
-}
+#include "arx_simd.h"
 
+// Independent scalar reference for arx_bias --check: own rounds, not chacha20_simd.c macros
 // quarter round as defined in RFC 8439
 //chacha20 quarter round macro
 #define QUARTERROUND(a, b, c, d) \
@@ -25,22 +23,6 @@ static inline uint32_t ROTL32(uint32_t x, int r) {
         b = ROTL32(b, 7);        \
     } while (0)
 
-// load 32-bit little-endian
-static inline uint32_t load32_le(const uint8_t *p) {
-    return (uint32_t)p[0]
-         | ((uint32_t)p[1] << 8)
-         | ((uint32_t)p[2] << 16)
-         | ((uint32_t)p[3] << 24);
-}
-
-// store 32-bit little-endian
-static inline void store32_le(uint8_t *p, uint32_t v) {
-    p[0] = (uint8_t)(v);
-    p[1] = (uint8_t)(v >> 8);
-    p[2] = (uint8_t)(v >> 16);
-    p[3] = (uint8_t)(v >> 24);
-}
-
 // ChaCha20 block function: input is 16 words (constants, key, counter, nonce)
 // output is 64 bytes (16 words little endian)
 static void chacha20_block(uint8_t out[64], const uint32_t input[16]) {
@@ -0,0 +1,244 @@
+// chacha20_kscache.c
+// Keystream precomputation for latency-sensitive messages.
+//
+// When the (key, nonce, counter) of a message is known before its payload,
+// chacha20_ksc_prepare queues it in a bounded ring and a background thread
+// fills the entry with keystream through chacha20_xor_best (SIMD kernels
+// for whole blocks, chacha20_block for the tail). chacha20_ksc_xor then
+// looks the triple up and, on a hit, only XORs. Entries are single-use:
+// a consumed, evicted or cancelled entry is wiped before its buffer is
+// reused, so no keystream is ever handed out twice. When the ring is full
+// the oldest entry the worker is not writing is evicted.
+//
+// Build: gcc -O3 -std=c11 -pthread -c chacha20_kscache.c chacha20_simd.c
+
+#define _POSIX_C_SOURCE 200112L   // posix_memalign
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "arx_simd.h"
+#include "chacha20_simd.h"
+#include "chacha20_kscache.h"
+
+#define CHACHA20_KSC_DEFAULT_SLOTS 64
+#define CHACHA20_KSC_DEFAULT_BYTES 2048
+
+// Entry life cycle: FREE → PENDING → FILLING → READY → FREE
+enum { KSC_FREE, KSC_PENDING, KSC_FILLING, KSC_READY };
+
+typedef struct {
+    int state;
+    int cancelled;      // consumed or evicted while FILLING
+    uint64_t seq;       // prepare order, smallest = oldest
+    uint8_t key[32];
+    uint8_t nonce[12];
+    uint32_t counter;
+    size_t len;         // keystream bytes wanted, <= slot_bytes
+    uint8_t *ks;
+} ksc_entry;
+
+struct chacha20_ksc {
+    pthread_mutex_t lock;
+    pthread_cond_t work;
+    pthread_t worker;
+    int stop;
+    size_t n, slot_bytes;
+    uint64_t next_seq;
+    ksc_entry *e;
+    uint8_t *mem;
+    chacha20_ksc_stats stats;
+};
+
+// Back to FREE; called with the lock held and never on a FILLING entry
+static void entry_release(ksc_entry *e) {
+    arx_wipe(e->ks, e->len);
+    arx_wipe(e->key, sizeof(e->key));
+    e->state = KSC_FREE;
+    e->cancelled = 0;
+}
+
+static void *ksc_worker(void *arg) {
+    chacha20_ksc *c = arg;
+    pthread_mutex_lock(&c->lock);
+    for (;;) {
+        // Oldest pending entry first, in the order messages were announced
+        ksc_entry *job = NULL;
+        for (size_t i = 0; i < c->n; i++) {
+            ksc_entry *e = &c->e[i];
+            if (e->state == KSC_PENDING && (job == NULL || e->seq < job->seq)) job = e;
+        }
+        if (job == NULL) {
+            if (c->stop) break;
+            pthread_cond_wait(&c->work, &c->lock);
+            continue;
+        }
+        job->state = KSC_FILLING;
+        uint8_t key[32], nonce[12];
+        memcpy(key, job->key, sizeof(key));
+        memcpy(nonce, job->nonce, sizeof(nonce));
+        uint32_t counter = job->counter;
+        size_t len = job->len;
+        pthread_mutex_unlock(&c->lock);
+
+        memset(job->ks, 0, len);
+        chacha20_xor_best(job->ks, job->ks, len, key, nonce, counter);
+        arx_wipe(key, sizeof(key));
+
+        pthread_mutex_lock(&c->lock);
+        if (job->cancelled) {
+            entry_release(job);
+        } else {
+            job->state = KSC_READY;
+        }
+    }
+    pthread_mutex_unlock(&c->lock);
+    return NULL;
+}
+
+chacha20_ksc *chacha20_ksc_create(const chacha20_ksc_opts *opts) {
+    size_t n = (opts && opts->slots) ? opts->slots : CHACHA20_KSC_DEFAULT_SLOTS;
+    size_t bytes = (opts && opts->slot_bytes) ? opts->slot_bytes : CHACHA20_KSC_DEFAULT_BYTES;
+    bytes = (bytes + 63) & ~(size_t)63;
+
+    chacha20_ksc *c = calloc(1, sizeof(*c));
+    if (c == NULL) return NULL;
+    c->n = n;
+    c->slot_bytes = bytes;
+    c->e = calloc(n, sizeof(*c->e));
+    if (c->e == NULL || posix_memalign((void **)&c->mem, 64, n * bytes) != 0) {
+        free(c->e);
+        free(c);
+        return NULL;
+    }
+    for (size_t i = 0; i < n; i++) {
+        c->e[i].ks = c->mem + i * bytes;
+    }
+    pthread_mutex_init(&c->lock, NULL);
+    pthread_cond_init(&c->work, NULL);
+    if (pthread_create(&c->worker, NULL, ksc_worker, c) != 0) {
+        pthread_cond_destroy(&c->work);
+        pthread_mutex_destroy(&c->lock);
+        free(c->mem);
+        free(c->e);
+        free(c);
+        return NULL;
+    }
+    return c;
+}
+
+void chacha20_ksc_destroy(chacha20_ksc *c) {
+    if (c == NULL) return;
+    pthread_mutex_lock(&c->lock);
+    c->stop = 1;
+    // Unfilled entries are dropped, not generated
+    for (size_t i = 0; i < c->n; i++) {
+        if (c->e[i].state == KSC_PENDING) c->e[i].state = KSC_FREE;
+    }
+    pthread_cond_signal(&c->work);
+    pthread_mutex_unlock(&c->lock);
+    pthread_join(c->worker, NULL);
+
+    arx_wipe(c->mem, c->n * c->slot_bytes);
+    arx_wipe(c->e, c->n * sizeof(*c->e));
+    pthread_cond_destroy(&c->work);
+    pthread_mutex_destroy(&c->lock);
+    free(c->mem);
+    free(c->e);
+    free(c);
+}
+
+int chacha20_ksc_prepare(chacha20_ksc *c, const uint8_t key[32],
+                         const uint8_t nonce[12], uint32_t counter, size_t len) {
+    // Whole blocks, so a longer message continues at a block boundary
+    len = (len + 63) & ~(size_t)63;
+    if (len > c->slot_bytes) len = c->slot_bytes;
+    pthread_mutex_lock(&c->lock);
+    ksc_entry *slot = NULL, *oldest = NULL;
+    for (size_t i = 0; i < c->n && slot == NULL; i++) {
+        ksc_entry *e = &c->e[i];
+        if (e->state == KSC_FREE) {
+            slot = e;
+        } else if (e->state != KSC_FILLING && (oldest == NULL || e->seq < oldest->seq)) {
+            oldest = e;
+        }
+    }
+    if (slot == NULL && oldest != NULL) {
+        entry_release(oldest);
+        c->stats.evicted++;
+        slot = oldest;
+    }
+    if (slot == NULL) {
+        pthread_mutex_unlock(&c->lock);
+        return -1;
+    }
+    memcpy(slot->key, key, sizeof(slot->key));
+    memcpy(slot->nonce, nonce, sizeof(slot->nonce));
+    slot->counter = counter;
+    slot->len = len;
+    slot->seq = c->next_seq++;
+    slot->state = KSC_PENDING;
+    c->stats.prepared++;
+    pthread_cond_signal(&c->work);
+    pthread_mutex_unlock(&c->lock);
+    return 0;
+}
+
+int chacha20_ksc_xor(chacha20_ksc *c, uint8_t *out, const uint8_t *in, size_t len,
+                     const uint8_t key[32], const uint8_t nonce[12], uint32_t counter) {
+    pthread_mutex_lock(&c->lock);
+    ksc_entry *hit = NULL;
+    for (size_t i = 0; i < c->n; i++) {
+        ksc_entry *e = &c->e[i];
+        if (e->state != KSC_FREE && !e->cancelled && e->counter == counter &&
+            memcmp(e->nonce, nonce, sizeof(e->nonce)) == 0 &&
+            memcmp(e->key, key, sizeof(e->key)) == 0) {
+            hit = e;
+            break;
+        }
+    }
+    if (hit == NULL || hit->state != KSC_READY) {
+        // Not generated yet: computing inline beats waiting for the worker.
+        // The entry is dropped so its keystream can never be used later.
+        if (hit != NULL) {
+            if (hit->state == KSC_FILLING) {
+                hit->cancelled = 1;
+            } else {
+                entry_release(hit);
+            }
+        }
+        c->stats.misses++;
+        pthread_mutex_unlock(&c->lock);
+        chacha20_xor_best(out, in, len, key, nonce, counter);
+        return 0;
+    }
+    // Take the entry out of the ring, then XOR without holding the lock
+    hit->state = KSC_FILLING;
+    hit->cancelled = 1;
+    c->stats.hits++;
+    pthread_mutex_unlock(&c->lock);
+
+    size_t n = len < hit->len ? len : hit->len;
+    const uint8_t *ks = hit->ks;
+    for (size_t i = 0; i < n; i++) {
+        out[i] = in[i] ^ ks[i];
+    }
+    if (len > n) {
+        // Longer than what was precomputed: the rest continues at the next block
+        chacha20_xor_best(out + n, in + n, len - n, key, nonce, counter + (uint32_t)(n / 64));
+    }
+
+    pthread_mutex_lock(&c->lock);
+    entry_release(hit);
+    pthread_mutex_unlock(&c->lock);
+    return 1;
+}
+
+void chacha20_ksc_get_stats(chacha20_ksc *c, chacha20_ksc_stats *stats) {
+    pthread_mutex_lock(&c->lock);
+    *stats = c->stats;
+    pthread_mutex_unlock(&c->lock);
+}
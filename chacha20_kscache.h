@@ -0,0 +1,43 @@
+// chacha20_kscache.h
+// Keystream precomputation cache (chacha20_kscache.c): a background thread
+// generates ChaCha20 keystream for announced (key, nonce, counter) triples
+// so that encrypting the message itself is a single XOR pass.
+
+#ifndef CHACHA20_KSCACHE_H
+#define CHACHA20_KSCACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef struct chacha20_ksc chacha20_ksc;
+
+// Tuning knobs; a zeroed struct (or NULL) picks the defaults.
+typedef struct {
+    size_t slots;       // ring entries, 0 = 64
+    size_t slot_bytes;  // keystream per entry, rounded up to 64, 0 = 2048
+} chacha20_ksc_opts;
+
+typedef struct {
+    uint64_t prepared;  // chacha20_ksc_prepare calls accepted
+    uint64_t hits;      // xor calls served (at least partly) from the ring
+    uint64_t misses;    // xor calls with no ready entry, computed inline
+    uint64_t evicted;   // entries dropped unused to make room, oldest first
+} chacha20_ksc_stats;
+
+// NULL if memory or the background thread cannot be had
+chacha20_ksc *chacha20_ksc_create(const chacha20_ksc_opts *opts);
+void chacha20_ksc_destroy(chacha20_ksc *c);
+
+// Announce a message of up to len bytes (only the first slot_bytes are
+// precomputed). Returns 0, or -1 if no entry could be freed for it.
+int chacha20_ksc_prepare(chacha20_ksc *c, const uint8_t key[32],
+                         const uint8_t nonce[12], uint32_t counter, size_t len);
+
+// Same result as chacha20_xor_best. Consumes the matching entry, so every
+// precomputed keystream is used at most once. Returns 1 on a hit, 0 on a miss.
+int chacha20_ksc_xor(chacha20_ksc *c, uint8_t *out, const uint8_t *in, size_t len,
+                     const uint8_t key[32], const uint8_t nonce[12], uint32_t counter);
+
+void chacha20_ksc_get_stats(chacha20_ksc *c, chacha20_ksc_stats *stats);
+
+#endif
@@ -0,0 +1,143 @@
+// chacha20_mt.c
+// Multi-threaded ChaCha20 for very large buffers.
+//
+// ChaCha20 blocks are independent, so the buffer is cut into 64-byte aligned
+// chunks and chunk c simply starts at block counter + c*chunk_size/64. Workers
+// claim chunks from a shared atomic index and run chacha20_xor_best on them;
+// the output is byte-identical to a single chacha20_xor_best call.
+// The calling thread works as well, so a failed pthread_create only costs
+// parallelism, never correctness.
+//
+// Build: gcc -O3 -std=c11 -pthread -c chacha20_mt.c chacha20_simd.c
+
+#if defined(__linux__)
+  #define _GNU_SOURCE   // pthread_setaffinity_np, CPU_SET
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+#if defined(__linux__)
+  #include <sched.h>
+#endif
+
+#include "chacha20_simd.h"
+#include "chacha20_mt.h"
+
+#define CHACHA20_MT_DEFAULT_CHUNK (1u << 20)
+#define CHACHA20_MT_MAX_THREADS   256
+
+// Shared job description, read-only except for the chunk cursor
+typedef struct {
+    uint8_t *out;
+    const uint8_t *in;
+    size_t len;
+    const uint8_t *key;
+    const uint8_t *nonce;
+    uint32_t counter;
+    size_t chunk;
+    size_t n_chunks;
+    atomic_size_t next;     // next unclaimed chunk index
+    int pin;
+    int cpu_first;
+    long ncpu;
+} mt_job;
+
+typedef struct {
+    mt_job *job;
+    unsigned id;
+    int pin;                // bind this worker to its CPU
+} mt_worker;
+
+// Bind the calling thread to one CPU; silently ignored where unsupported
+static void mt_pin_self(const mt_job *job, unsigned id) {
+#if defined(__linux__)
+    if (job->ncpu <= 0) return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET((int)(((long)job->cpu_first + id) % job->ncpu), &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+    (void)job;
+    (void)id;
+#endif
+}
+
+// Claim chunks until none are left; chunk c covers bytes [c*chunk, ...)
+static void *mt_worker_main(void *arg) {
+    mt_worker *w = (mt_worker *)arg;
+    mt_job *job = w->job;
+    if (w->pin) mt_pin_self(job, w->id);
+    for (;;) {
+        size_t c = atomic_fetch_add_explicit(&job->next, 1, memory_order_relaxed);
+        if (c >= job->n_chunks) break;
+        size_t off = c * job->chunk;
+        size_t n = job->len - off < job->chunk ? job->len - off : job->chunk;
+        // off is a multiple of 64, so the slice starts on a block boundary
+        uint32_t ctr = job->counter + (uint32_t)(off >> 6);
+        chacha20_xor_best(job->out + off, job->in + off, n, job->key, job->nonce, ctr);
+    }
+    return NULL;
+}
+
+void chacha20_xor_mt(uint8_t *out, const uint8_t *in, size_t len,
+                     const uint8_t key[32], const uint8_t nonce[12],
+                     uint32_t counter, const chacha20_mt_opts *opts) {
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned threads = (opts && opts->threads) ? opts->threads
+                                               : (ncpu > 0 ? (unsigned)ncpu : 1);
+    size_t chunk = (opts && opts->chunk_size) ? opts->chunk_size : CHACHA20_MT_DEFAULT_CHUNK;
+    chunk = (chunk + 63) & ~(size_t)63;
+    if (threads > CHACHA20_MT_MAX_THREADS) threads = CHACHA20_MT_MAX_THREADS;
+
+    size_t n_chunks = len / chunk + (len % chunk != 0);
+    if (threads > n_chunks) threads = (unsigned)n_chunks;
+    // Nothing to split: skip thread setup entirely
+    if (threads <= 1) {
+        chacha20_xor_best(out, in, len, key, nonce, counter);
+        return;
+    }
+
+    mt_job job = {
+        .out = out, .in = in, .len = len, .key = key, .nonce = nonce,
+        .counter = counter, .chunk = chunk, .n_chunks = n_chunks,
+        .pin = opts ? opts->pin_threads : 0,
+        .cpu_first = opts ? opts->cpu_first : 0,
+        .ncpu = ncpu,
+    };
+    atomic_init(&job.next, 0);
+
+    pthread_t tids[CHACHA20_MT_MAX_THREADS];
+    mt_worker workers[CHACHA20_MT_MAX_THREADS];
+    int started[CHACHA20_MT_MAX_THREADS] = {0};
+    for (unsigned t = 1; t < threads; t++) {
+        workers[t].job = &job;
+        workers[t].id = t;
+        workers[t].pin = job.pin;
+        started[t] = pthread_create(&tids[t], NULL, mt_worker_main, &workers[t]) == 0;
+    }
+    // The caller is worker 0. It is pinned only if its own affinity mask
+    // can be saved, and gets that mask back afterwards.
+    workers[0].job = &job;
+    workers[0].id = 0;
+    workers[0].pin = 0;
+#if defined(__linux__)
+    cpu_set_t caller_set;
+    if (job.pin) {
+        workers[0].pin = pthread_getaffinity_np(pthread_self(), sizeof(caller_set),
+                                                &caller_set) == 0;
+    }
+#endif
+    mt_worker_main(&workers[0]);
+#if defined(__linux__)
+    if (workers[0].pin) {
+        pthread_setaffinity_np(pthread_self(), sizeof(caller_set), &caller_set);
+    }
+#endif
+
+    for (unsigned t = 1; t < threads; t++) {
+        if (started[t]) pthread_join(tids[t], NULL);
+    }
+}
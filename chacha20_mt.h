@@ -0,0 +1,26 @@
+// chacha20_mt.h
+// Multi-threaded bulk ChaCha20 (chacha20_mt.c) on top of chacha20_xor_best.
+
+#ifndef CHACHA20_MT_H
+#define CHACHA20_MT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Tuning knobs; a zeroed struct (or NULL) picks the defaults.
+typedef struct {
+    unsigned threads;     // worker count including the caller, 0 = online CPUs
+    size_t   chunk_size;  // bytes per work item, rounded up to 64, 0 = 1 MiB
+    int      pin_threads; // nonzero: bind worker i to CPU (cpu_first + i) % ncpu
+    int      cpu_first;   // first CPU used when pinning
+} chacha20_mt_opts;
+
+// The caller runs as worker 0. With pin_threads it is bound to cpu_first
+// for the duration of the call and its previous CPU affinity is restored
+// before returning; pool threads exit when the call returns.
+
+void chacha20_xor_mt(uint8_t *out, const uint8_t *in, size_t len,
+                     const uint8_t key[32], const uint8_t nonce[12],
+                     uint32_t counter, const chacha20_mt_opts *opts);
+
+#endif
@@ -0,0 +1,183 @@
+// chacha20_rng.c
+// Userspace CSPRNG built on the ChaCha20 keystream with fast key erasure
+// (D. J. Bernstein, "Fast-key-erasure random-number generators", 2017):
+//   • a root key is seeded once from the OS (getrandom / getentropy)
+//   • every thread draws its own key from the root on first use and keeps a
+//     private CHACHA_RNG_BUF byte buffer, so the hot path takes no lock
+//   • a refill runs chacha20_keystream over the whole buffer; the first 32
+//     bytes immediately become the next key and are wiped, so a later state
+//     compromise cannot reconstruct earlier output
+//   • bytes are wiped from the buffer as they are handed out
+//   • requests of a buffer or more are generated straight into the caller's
+//     memory by the SIMD kernels, with the rekey taken from block 0
+//   • after fork() the child reseeds the root and every thread in it
+//     rederives its key, so parent and child never share output
+//
+// Build: gcc -O3 -std=c11 -pthread -c chacha20_rng.c chacha20_simd.c
+
+#if defined(__linux__)
+  #define _GNU_SOURCE   // getrandom
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#if defined(__linux__) || defined(__APPLE__)
+  #include <sys/random.h>
+#endif
+
+#include "arx_simd.h"
+#include "chacha20_simd.h"
+#include "chacha20_rng.h"
+
+// Per-thread buffer size; each refill costs one rekey (32 bytes)
+#ifndef CHACHA_RNG_BUF
+#define CHACHA_RNG_BUF 8192
+#endif
+
+// Every key is used for exactly one stream, so a fixed nonce is fine
+static const uint8_t rng_nonce[12];
+
+static uint8_t root_key[32];
+static pthread_mutex_t root_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t root_once = PTHREAD_ONCE_INIT;
+static volatile unsigned root_gen = 1;   // bumped in a forked child
+
+typedef struct {
+    uint8_t key[32];
+    uint8_t buf[CHACHA_RNG_BUF];
+    size_t  pos;       // next unused byte of buf
+    unsigned gen;      // root generation the key came from, 0 = none
+} rng_thread_state;
+
+static _Thread_local rng_thread_state tls;
+
+// 32 bytes of OS entropy; there is no safe way to continue without it
+static void rng_os_seed(uint8_t out[32]) {
+#if defined(__linux__)
+    size_t got = 0;
+    while (got < 32) {
+        ssize_t r = getrandom(out + got, 32 - got, 0);
+        if (r < 0) {
+            perror("getrandom");
+            abort();
+        }
+        got += (size_t)r;
+    }
+#elif defined(__APPLE__)
+    if (getentropy(out, 32) != 0) {
+        perror("getentropy");
+        abort();
+    }
+#else
+    FILE *f = fopen("/dev/urandom", "rb");
+    if (!f || fread(out, 1, 32, f) != 32) {
+        fprintf(stderr, "chacha_rng: cannot read /dev/urandom\n");
+        abort();
+    }
+    fclose(f);
+#endif
+}
+
+// Child side of fork: fresh root, and invalidate every thread key
+static void rng_atfork_child(void) {
+    pthread_mutex_init(&root_lock, NULL);
+    rng_os_seed(root_key);
+    root_gen++;
+}
+
+static void rng_root_init(void) {
+    rng_os_seed(root_key);
+    pthread_atfork(NULL, NULL, rng_atfork_child);
+}
+
+// Hand a new thread key out of the root generator (itself fast-key-erasure)
+static void rng_root_draw(uint8_t out[32], unsigned *gen) {
+    uint8_t blk[64];
+    pthread_once(&root_once, rng_root_init);
+    pthread_mutex_lock(&root_lock);
+    chacha20_keystream(blk, sizeof(blk), root_key, rng_nonce, 0);
+    memcpy(root_key, blk, 32);
+    memcpy(out, blk + 32, 32);
+    *gen = root_gen;
+    pthread_mutex_unlock(&root_lock);
+    arx_wipe(blk, sizeof(blk));
+}
+
+// Regenerate the buffer; its first 32 bytes become the next key
+static void rng_refill(rng_thread_state *st) {
+    chacha20_keystream(st->buf, sizeof(st->buf), st->key, rng_nonce, 0);
+    memcpy(st->key, st->buf, 32);
+    arx_wipe(st->buf, 32);
+    st->pos = 32;
+}
+
+static rng_thread_state *rng_state(void) {
+    rng_thread_state *st = &tls;
+    if (st->gen != root_gen) {
+        rng_root_draw(st->key, &st->gen);
+        rng_refill(st);
+    }
+    return st;
+}
+
+void chacha_rng_bytes(void *out_v, size_t len) {
+    uint8_t *out = (uint8_t *)out_v;
+    rng_thread_state *st = rng_state();
+
+    // Serve what is left in the buffer first
+    size_t avail = sizeof(st->buf) - st->pos;
+    size_t n = len < avail ? len : avail;
+    memcpy(out, st->buf + st->pos, n);
+    arx_wipe(st->buf + st->pos, n);
+    st->pos += n;
+    out += n;
+    len -= n;
+    if (len == 0) return;
+
+    if (len >= sizeof(st->buf)) {
+        // Bulk: bytes 32.. of this key's stream go straight to the caller,
+        // bytes 0..31 become the next key
+        uint8_t next[32];
+        chacha20_keystream(out, len, st->key, rng_nonce, 32);
+        chacha20_keystream(next, sizeof(next), st->key, rng_nonce, 0);
+        memcpy(st->key, next, sizeof(next));
+        arx_wipe(next, sizeof(next));
+        rng_refill(st);
+        return;
+    }
+
+    rng_refill(st);
+    memcpy(out, st->buf + st->pos, len);
+    arx_wipe(st->buf + st->pos, len);
+    st->pos += len;
+}
+
+uint64_t chacha_rng_u64(void) {
+    uint8_t b[8];
+    uint64_t v = 0;
+    chacha_rng_bytes(b, sizeof(b));
+    for (int i = 0; i < 8; i++) {
+        v |= (uint64_t)b[i] << (8 * i);
+    }
+    return v;
+}
+
+//chacha_rng_uniform(bound):
+//  Lemire's multiply-and-reject: the high word of x*bound is uniform once
+//  the few low-word values below 2^64 mod bound are rejected.
+uint64_t chacha_rng_uniform(uint64_t bound) {
+    unsigned __int128 m = (unsigned __int128)chacha_rng_u64() * bound;
+    uint64_t low = (uint64_t)m;
+    if (low < bound) {
+        uint64_t threshold = (0 - bound) % bound;
+        while (low < threshold) {
+            m = (unsigned __int128)chacha_rng_u64() * bound;
+            low = (uint64_t)m;
+        }
+    }
+    return (uint64_t)(m >> 64);
+}
@@ -0,0 +1,20 @@
+// chacha20_rng.h
+// Fast-key-erasure CSPRNG on ChaCha20 keystream (chacha20_rng.c).
+
+#ifndef CHACHA20_RNG_H
+#define CHACHA20_RNG_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Fill out with len random bytes. Thread-safe, fork-safe, never fails
+// (aborts if the OS cannot provide the initial seed).
+void chacha_rng_bytes(void *out, size_t len);
+
+// Uniform 64-bit value
+uint64_t chacha_rng_u64(void);
+
+// Uniform value in [0, bound), no modulo bias; bound must be > 0
+uint64_t chacha_rng_uniform(uint64_t bound);
+
+#endif
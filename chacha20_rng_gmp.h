@@ -0,0 +1,39 @@
+// chacha20_rng_gmp.h
+// GMP integers from the ChaCha20 CSPRNG (chacha20_rng.c): what rsa.c and
+// the primality tools use in place of a gmp_randstate_t. Include after
+// <gmp.h>; link chacha20_rng.c and chacha20_simd.c.
+
+#ifndef CHACHA20_RNG_GMP_H
+#define CHACHA20_RNG_GMP_H
+
+#include <gmp.h>
+#include <stdlib.h>
+
+#include "arx_simd.h"
+#include "chacha20_rng.h"
+
+// x = uniform random integer in [0, 2^bits), like mpz_urandomb. The byte
+// buffer is wiped, since callers include RSA prime generation.
+static inline void chacha_rng_mpz_bits(mpz_t x, mp_bitcnt_t bits) {
+    unsigned char stack_buf[256];
+    size_t nbytes = (bits + 7) / 8;
+    unsigned char *buf = nbytes <= sizeof(stack_buf) ? stack_buf : malloc(nbytes);
+    if (buf == NULL) abort();
+    chacha_rng_bytes(buf, nbytes);
+    mpz_import(x, nbytes, 1, 1, 0, 0, buf);
+    mpz_fdiv_r_2exp(x, x, bits);
+    arx_wipe(buf, nbytes);
+    if (buf != stack_buf) free(buf);
+}
+
+// x = uniform random integer in [0, bound), like mpz_urandomm; bound > 0.
+// Draws as many bits as bound has and rejects values >= bound (fewer than
+// two draws on average), so there is no modulo bias.
+static inline void chacha_rng_mpz_below(mpz_t x, const mpz_t bound) {
+    mp_bitcnt_t bits = mpz_sizeinbase(bound, 2);
+    do {
+        chacha_rng_mpz_bits(x, bits);
+    } while (mpz_cmp(x, bound) >= 0);
+}
+
+#endif
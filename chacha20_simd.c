@@ -4,43 +4,30 @@
 
 //chacha20_simd.c – comprehensive ChaCha20 stream‐cipher implementation:
 //   chacha20_block: single 64-byte block core (20 rounds of mixing)
+//   chacha8_xor / chacha12_xor: reduced-round variants of chacha20_xor_best
+//   chacha20_xor_batch: many short messages, one message per SIMD lane
 //   chacha20_xor_interleaved4: 4-block interleaved scalar path to hide instruction and memory latency
 //   chacha20_xor_neon4: 4-way SIMD via ARM NEON for maximum throughput on M1
+//   chacha20_xor_neon8: two interleaved 4-way NEON states, 8 blocks per pass
+//   chacha20_xor_ssse3: 4-way SIMD via SSE2/SSSE3 on x86_64
+//   chacha20_xor_avx2: 8-way SIMD via AVX2 on x86_64
+//   chacha20_xor_avx512: 16-way SIMD via AVX-512F (vprold rotates) on x86_64
 //   chacha20_xor_best: dispatch helper choosing the fastest available path
+//   chacha20_autotune: per-machine length thresholds for that choice
+//   chacha20_init/update/final: streaming context with partial-block carry
+//   chacha20_seek / chacha20_keystream: random access at any byte offset
+//   chacha20_xorv / chacha20_updatev: scatter-gather over iovec chains
+//   hchacha20 / xchacha20_xor: 192-bit nonce variant
+//   chacha20_djb_xor / chacha20_djb_init: 64-bit counter, 64-bit nonce variant
 
 #include <stdint.h>
 #include <stddef.h>
+#include <stdio.h>
 #include <string.h>
+#include <time.h>
 
-#if defined(__ARM_NEON) || defined(__ARM_NEON__)
-  #include <arm_neon.h>
-  #define HAVE_NEON 1
-#else
-  #define HAVE_NEON 0
-#endif
-
-//ROTL32(x, r):
-//  Perform a 32-bit circular left rotation of x by r bits.
-//  This is the basic bit-mixing primitive in ChaCha, allowing low-cost nonlinear diffusion
-//  by repositioning bits within a word before XOR/add operations
-// 32-bit left rotate
-static inline uint32_t ROTL32(uint32_t x, int r) {
-    return (x << r) | (x >> (32 - r));
-}
-
-// little-endian load/store
-static inline uint32_t load32_le(const uint8_t *p) {
-    return (uint32_t)p[0]        
-         | ((uint32_t)p[1] << 8)  
-         | ((uint32_t)p[2] << 16) 
-         | ((uint32_t)p[3] << 24);
-}
-static inline void store32_le(uint8_t *p, uint32_t v) {
-    p[0] = (uint8_t)v;
-    p[1] = (uint8_t)(v >> 8);
-    p[2] = (uint8_t)(v >> 16);
-    p[3] = (uint8_t)(v >> 24);
-}
+#include "chacha20_simd.h"
+#include "arx_simd.h"
 
 //QUARTERROUND(a, b, c, d):
   //The fundamental mixing step from RFC 8439. Takes four 32-bit words (a,b,c,d) and applies:
@@ -80,6 +67,48 @@ static inline void store32_le(uint8_t *p, uint32_t v) {
         b = ROTL32(b, 7);              \
     } while (0)
 
+// CHACHA_UNROLL:
+//   Placed in front of every round loop; ARX_UNROLL from arx_simd.h.
+//   Kernels are instantiated with a constant 8, 12 or 20
+//   (CHACHA_KERNEL_VARIANTS), so each round loop is unrolled completely.
+#define CHACHA_UNROLL ARX_UNROLL
+
+// CHACHA_DOUBLEROUNDS(rounds):
+//   `rounds` rounds (column + diagonal double rounds) on scalar locals
+//   x0…x15, which must be in scope. Shared by the block function and
+//   hchacha20, which differ only in what they do with the result.
+#define CHACHA_DOUBLEROUNDS(rounds)                    \
+    do {                                               \
+        CHACHA_UNROLL                                  \
+        for (int i_ = 0; i_ < (rounds); i_ += 2) {     \
+            /* Column rounds */                        \
+            QUARTERROUND(x0, x4, x8,  x12);            \
+            QUARTERROUND(x1, x5, x9,  x13);            \
+            QUARTERROUND(x2, x6, x10, x14);            \
+            QUARTERROUND(x3, x7, x11, x15);            \
+            /* Diagonal rounds */                      \
+            QUARTERROUND(x0, x5, x10, x15);            \
+            QUARTERROUND(x1, x6, x11, x12);            \
+            QUARTERROUND(x2, x7, x8,  x13);            \
+            QUARTERROUND(x3, x4, x9,  x14);            \
+        }                                              \
+    } while (0)
+
+// CHACHA_DOUBLEROUND(QR, x):
+//   One column and one diagonal round over the word vectors x[0..15] of
+//   the multi-lane kernels, with the vector quarter round QR of one ISA.
+#define CHACHA_DOUBLEROUND(QR, x)                      \
+    do {                                               \
+        QR(x[0], x[4], x[8],  x[12]);                  \
+        QR(x[1], x[5], x[9],  x[13]);                  \
+        QR(x[2], x[6], x[10], x[14]);                  \
+        QR(x[3], x[7], x[11], x[15]);                  \
+        QR(x[0], x[5], x[10], x[15]);                  \
+        QR(x[1], x[6], x[11], x[12]);                  \
+        QR(x[2], x[7], x[8],  x[13]);                  \
+        QR(x[3], x[4], x[9],  x[14]);                  \
+    } while (0)
+
 // ChaCha20 block function: input is 16 words (constants, key, counter, nonce)
 // output is 64 bytes (16 words little endian)
 // This function performs 20 rounds of mixing on the input state, which consists of
@@ -93,25 +122,15 @@ static inline void store32_le(uint8_t *p, uint32_t v) {
 //  This gives you one 64-byte keystream block
 //  that can be XORed with plaintext/ciphertext to encrypt/decrypt.
 
-// Single-block ChaCha20 core: outputs 64-byte keystream
-static void chacha20_block(uint8_t out[64], const uint32_t input[16]) {
+// Single-block ChaCha core: outputs 64-byte keystream after `rounds` rounds
+static inline __attribute__((always_inline))
+void chacha_block_tmpl(uint8_t out[64], const uint32_t input[16], int rounds) {
     uint32_t x0 = input[0],  x1 = input[1],  x2 = input[2],  x3 = input[3];
     uint32_t x4 = input[4],  x5 = input[5],  x6 = input[6],  x7 = input[7];
     uint32_t x8 = input[8],  x9 = input[9],  x10 = input[10], x11 = input[11];
     uint32_t x12 = input[12], x13 = input[13], x14 = input[14], x15 = input[15];
 
-    for (int i = 0; i < 10; i++) {
-        // Column rounds
-        QUARTERROUND(x0, x4, x8,  x12);
-        QUARTERROUND(x1, x5, x9,  x13);
-        QUARTERROUND(x2, x6, x10, x14);
-        QUARTERROUND(x3, x7, x11, x15);
-        // Diagonal rounds
-        QUARTERROUND(x0, x5, x10, x15);
-        QUARTERROUND(x1, x6, x11, x12);
-        QUARTERROUND(x2, x7, x8,  x13);
-        QUARTERROUND(x3, x4, x9,  x14);
-    }
+    CHACHA_DOUBLEROUNDS(rounds);
 
     // Feed-forward and serialize to out in little-endian
     // This adds the original input state back to the mixed state
@@ -136,6 +155,11 @@ static void chacha20_block(uint8_t out[64], const uint32_t input[16]) {
     store32_le(out + 60, x15 + input[15]);
 }
 
+// ChaCha20 block, used by the streaming context and the single-block tails
+static void chacha20_block(uint8_t out[64], const uint32_t input[16]) {
+    chacha_block_tmpl(out, input, 20);
+}
+
 //chacha20_init_state(state, key, nonce, counter):
 //  Initialize the 4×4 ChaCha matrix:
 //    state[0..3]  = constant bytes of “expand 32-byte k”
@@ -169,25 +193,89 @@ static void chacha20_init_state(uint32_t state[16],
     state[15] = load32_le(nonce + 8);
 }
 
-//chacha20_xor_interleaved4(out, in, len, …):
+//chacha20_djb_init_state(state, key, nonce, counter):
+//  Original ChaCha layout from Bernstein's paper: words 12–13 are a 64-bit
+//  block counter (low word first) and words 14–15 a 64-bit nonce. 2^64
+//  blocks per nonce instead of the 2^32 (256 GiB) of the RFC 8439 layout.
+static void chacha20_djb_init_state(uint32_t state[16],
+                                    const uint8_t key[32],
+                                    const uint8_t nonce[8],
+                                    uint64_t counter) {
+    state[0]  = 0x61707865;
+    state[1]  = 0x3320646e;
+    state[2]  = 0x79622d32;
+    state[3]  = 0x6b206574;
+    for (int i = 0; i < 8; i++) {
+        state[4 + i] = load32_le(key + 4 * i);
+    }
+    state[12] = (uint32_t)counter;
+    state[13] = (uint32_t)(counter >> 32);
+    state[14] = load32_le(nonce + 0);
+    state[15] = load32_le(nonce + 4);
+}
+
+//chacha20_ctr_add(state, n, ctr64):
+//  Advance the block counter by n blocks. In the RFC 8439 layout the counter
+//  is the 32-bit word 12 and wraps; with ctr64 (original DJB layout) words
+//  12–13 form one 64-bit counter and the carry goes into word 13.
+#define CHACHA_CTR_WORD(ctr64) 12
+static inline void chacha20_ctr_add(uint32_t state[16], uint32_t n, int ctr64) {
+    arx_ctr_add(state, CHACHA_CTR_WORD(ctr64), n, ctr64);
+}
+
+// CHACHA_KERNEL_VARIANTS(name, attr):
+//   Stamp out ChaCha8, ChaCha12 and ChaCha20 instances of the kernel template
+//   chacha_blocks_<name>_tmpl (attr carries its target attribute), plus
+//   chacha_blocks_<name>, which picks the instance for a run-time round
+//   count. Any other count falls back to 20 rounds.
+#define CHACHA_KERNEL_VARIANTS(name, attr)                                          \
+    attr static void chacha_blocks_##name##_r8(uint8_t *out, const uint8_t *in,     \
+                                               size_t len, uint32_t state[16],      \
+                                               int ctr64) {                         \
+        chacha_blocks_##name##_tmpl(out, in, len, state, ctr64, 8);                 \
+    }                                                                               \
+    attr static void chacha_blocks_##name##_r12(uint8_t *out, const uint8_t *in,    \
+                                                size_t len, uint32_t state[16],     \
+                                                int ctr64) {                        \
+        chacha_blocks_##name##_tmpl(out, in, len, state, ctr64, 12);                \
+    }                                                                               \
+    attr static void chacha_blocks_##name##_r20(uint8_t *out, const uint8_t *in,    \
+                                                size_t len, uint32_t state[16],     \
+                                                int ctr64) {                        \
+        chacha_blocks_##name##_tmpl(out, in, len, state, ctr64, 20);                \
+    }                                                                               \
+    static void chacha_blocks_##name(uint8_t *out, const uint8_t *in, size_t len,   \
+                                     uint32_t state[16], int ctr64, int rounds) {   \
+        switch (rounds) {                                                           \
+        case 8:  chacha_blocks_##name##_r8(out, in, len, state, ctr64);  break;     \
+        case 12: chacha_blocks_##name##_r12(out, in, len, state, ctr64); break;     \
+        default: chacha_blocks_##name##_r20(out, in, len, state, ctr64); break;     \
+        }                                                                           \
+    }
+
+//chacha_blocks_interleaved4(out, in, len, state):
 //  Process data in 256-byte chunks (4×64):
-//    1. For k = 0…3: init state with counter+k, call chacha20_block -> block[k]
+//    1. For k = 0…3: copy the prepared state with counter+k, call chacha20_block -> block[k]
 //    2. XOR each 64-byte block[k] with its corresponding input segment
 //  This dead-simple interleaving hides the ~20-round latency by keeping four independent
 //  ChaCha blocks in flight, improving throughput on out-of-order CPUs without SIMD.
-// // This is a scalar path that interleaves four blocks to hide latency.
+//  Like every chacha_blocks_* kernel it works from an already expanded
+//  state and advances the counter by the number of blocks it consumed, so the
+//  streaming context can hand the same state from call to call. With ctr64
+//  the counter is 64 bits wide (words 12–13) and every lane carries on its own.
 // 4-way interleaved scalar path
-void chacha20_xor_interleaved4(uint8_t *out, const uint8_t *in, size_t len,
-                               const uint8_t key[32], const uint8_t nonce[12],
-                               uint32_t counter) {
+static inline __attribute__((always_inline))
+void chacha_blocks_interleaved4_tmpl(uint8_t *out, const uint8_t *in, size_t len,
+                                     uint32_t state[16], int ctr64, int rounds) {
     uint8_t block[4][64];
+    uint32_t st[4][16];
     size_t off = 0;
     while (len >= 256) {
         // Generate 4 blocks
         for (int k = 0; k < 4; k++) {
-            uint32_t st[16];
-            chacha20_init_state(st, key, nonce, counter + k);
-            chacha20_block(block[k], st);
+            memcpy(st[k], state, sizeof(st[k]));
+            chacha20_ctr_add(st[k], (uint32_t)k, ctr64);
+            chacha_block_tmpl(block[k], st[k], rounds);
         }
         // XOR
         for (int k = 0; k < 4; k++) {
@@ -197,35 +285,43 @@ void chacha20_xor_interleaved4(uint8_t *out, const uint8_t *in, size_t len,
         }
         off += 256;
         len -= 256;
-        counter += 4;
+        chacha20_ctr_add(state, 4, ctr64);
     }
-    // Tail fallback
     // Tail fallback: if remaining data < 256 bytes, fall back to single-block scalar mode.
     // This loop handles the last 1–255 bytes correctly without overrun.
     while (len > 0) {
-        uint32_t st[16];
         uint8_t buf[64];
         size_t c = (len < 64 ? len : 64);
-        chacha20_init_state(st, key, nonce, counter);
-        chacha20_block(buf, st);
+        chacha_block_tmpl(buf, state, rounds);
         for (size_t i = 0; i < c; i++) {
             out[off + i] = in[off + i] ^ buf[i];
         }
         off += c;
         len -= c;
-        counter++;
+        chacha20_ctr_add(state, 1, ctr64);
     }
 }
 
+CHACHA_KERNEL_VARIANTS(interleaved4, )
+
+// 4-way interleaved scalar path, one-shot API
+void chacha20_xor_interleaved4(uint8_t *out, const uint8_t *in, size_t len,
+                               const uint8_t key[32], const uint8_t nonce[12],
+                               uint32_t counter) {
+    uint32_t state[16];
+    chacha20_init_state(state, key, nonce, counter);
+    chacha_blocks_interleaved4(out, in, len, state, 0, 20);
+}
+
 #if HAVE_NEON
 // NEON fixed rotates
 // NEON fixed-rotate macros (ROTL16/12/8/7):
 //   ARM NEON intrinsics require constant shift amounts. These macros implement
 //   the four rotate constants used by the quarter‐round, all in vector form.
-#define ROTL16(v) vorrq_u32(vshlq_n_u32(v, 16), vshrq_n_u32(v, 16))
-#define ROTL12(v) vorrq_u32(vshlq_n_u32(v, 12), vshrq_n_u32(v, 20))
-#define ROTL8(v)  vorrq_u32(vshlq_n_u32(v, 8),  vshrq_n_u32(v, 24))
-#define ROTL7(v)  vorrq_u32(vshlq_n_u32(v, 7),  vshrq_n_u32(v, 25))
+#define ROTL16(v) NEON_ROTL(v, 16)
+#define ROTL12(v) NEON_ROTL(v, 12)
+#define ROTL8(v)  NEON_ROTL(v, 8)
+#define ROTL7(v)  NEON_ROTL(v, 7)
 
 // NEON quarter round on 4 lanes
 // NEON_QR(a, b, c, d):
@@ -250,121 +346,962 @@ void chacha20_xor_interleaved4(uint8_t *out, const uint8_t *in, size_t len,
         b = ROTL7(b);                  \
     } while (0)
 
-
 //chacha20_xor_neon4(out, in, len, …):
-//  Vectorized 4-way ChaCha20 using NEON registers:
-//    - Broadcast constants, key words, counter vector, and nonce into 16 uint32x4 vectors
-//    - Perform 20 rounds by invoking NEON_QR on columns & diagonals
-//    - Feed-forward: add the original input vectors back
-//    - Gather lanes 0–3 from each vector to form four 64-byte keystream blocks
-//    - XOR them with four input segments in lockstep
-//  This achieves ~4× the per-byte throughput of scalar code on ARM64.    
-// NEON 4-way SIMD path
+//  Vectorized 4-way ChaCha20 using NEON registers, on the ARX state
+//  vectors of arx_simd.h:
+//    - Broadcast the state into 16 uint32x4 vectors, lane k at counter+k
+//    - Perform the rounds by invoking NEON_QR on columns & diagonals
+//    - Feed-forward, transpose in registers (NEON_TRANSPOSE4) so each
+//      vector holds 16 bytes of one block, and XOR whole vectors against
+//      the input
+//  This achieves ~4× the per-byte throughput of scalar code on ARM64.
+ARX_KERNEL(chacha_blocks_neon4, neon, uint32x4_t, 4, ,
+           CHACHA_DOUBLEROUND, NEON_QR, CHACHA_CTR_WORD, chacha_blocks_interleaved4)
+
+CHACHA_KERNEL_VARIANTS(neon4, )
+
+// NEON 4-way SIMD path, one-shot API
 void chacha20_xor_neon4(uint8_t *out, const uint8_t *in, size_t len,
-                       const uint8_t key[32], const uint8_t nonce[12],
-                       uint32_t counter) {
+                        const uint8_t key[32], const uint8_t nonce[12],
+                        uint32_t counter) {
+    uint32_t state[16];
+    chacha20_init_state(state, key, nonce, counter);
+    chacha_blocks_neon4(out, in, len, state, 0, 20);
+}
+
+// NEON_QR_X2(a, b, c, d):
+//   NEON_QR on words a, b, c, d of state a and on the same words 16
+//   vectors further on, state b, for the 8-way kernel.
+#define NEON_QR_X2(a, b, c, d)                                          \
+    do {                                                                \
+        NEON_QR(a, b, c, d);                                            \
+        NEON_QR((&(a))[16], (&(b))[16], (&(c))[16], (&(d))[16]);        \
+    } while (0)
+
+//chacha20_xor_neon8(out, in, len, …):
+//  Two independent 4-way states (blocks 0–3 in a[], 4–7 in b[]) run
+//  through the rounds side by side, 512 bytes per pass. A single 4-way
+//  state leaves the NEON pipes idle on the add→xor→rotate dependency chain;
+//  the second state fills them, as on M1/M2 and Graviton there are enough
+//  vector registers for both. Output is transposed in registers and XORed
+//  16 bytes at a time, with no keystream buffer in memory. Tails below
+//  512 bytes go to the 4-way kernel.
+static inline __attribute__((always_inline))
+void chacha_blocks_neon8_tmpl(uint8_t *out, const uint8_t *in, size_t len,
+                              uint32_t state[16], int ctr64, int rounds) {
     size_t off = 0;
-    uint8_t ks[4][64];
-    while (len >= 256) {
-        // Load input state into vectors
-        // Broadcast constants, key, counter, nonce
-        // 16 vectors: 4x4 matrix
-        // Each vector holds 4 words (16 bytes)
-        uint32x4_t in0  = vdupq_n_u32(0x61707865);
-        uint32x4_t in1  = vdupq_n_u32(0x3320646e);
-        uint32x4_t in2  = vdupq_n_u32(0x79622d32);
-        uint32x4_t in3  = vdupq_n_u32(0x6b206574);
-        uint32x4_t in4  = vdupq_n_u32(load32_le(key + 0));
-        uint32x4_t in5  = vdupq_n_u32(load32_le(key + 4));
-        uint32x4_t in6  = vdupq_n_u32(load32_le(key + 8));
-        uint32x4_t in7  = vdupq_n_u32(load32_le(key + 12));
-        uint32x4_t in8  = vdupq_n_u32(load32_le(key + 16));
-        uint32x4_t in9  = vdupq_n_u32(load32_le(key + 20));
-        uint32x4_t in10 = vdupq_n_u32(load32_le(key + 24));
-        uint32x4_t in11 = vdupq_n_u32(load32_le(key + 28));
-        uint32x4_t in12 = { counter, counter+1, counter+2, counter+3 };
-        uint32x4_t in13 = vdupq_n_u32(load32_le(nonce + 0));
-        uint32x4_t in14 = vdupq_n_u32(load32_le(nonce + 4));
-        uint32x4_t in15 = vdupq_n_u32(load32_le(nonce + 8));
-        // Working copy
-        uint32x4_t x0=in0,  x1=in1,  x2=in2,  x3=in3;
-        uint32x4_t x4=in4,  x5=in5,  x6=in6,  x7=in7;
-        uint32x4_t x8=in8,  x9=in9,  x10=in10,x11=in11;
-        uint32x4_t x12=in12,x13=in13,x14=in14,x15=in15;
-        // 20 rounds
-        for (int i = 0; i < 10; i++) {
-            NEON_QR(x0, x4, x8,  x12);
-            NEON_QR(x1, x5, x9,  x13);
-            NEON_QR(x2, x6, x10, x14);
-            NEON_QR(x3, x7, x11, x15);
-            NEON_QR(x0, x5, x10, x15);
-            NEON_QR(x1, x6, x11, x12);
-            NEON_QR(x2, x7, x8,  x13);
-            NEON_QR(x3, x4, x9,  x14);
-        }
-        // Feed-forward
-        x0  = vaddq_u32(x0, in0);
-        x1  = vaddq_u32(x1, in1);
-        x2  = vaddq_u32(x2, in2);
-        x3  = vaddq_u32(x3, in3);
-        x4  = vaddq_u32(x4, in4);
-        x5  = vaddq_u32(x5, in5);
-        x6  = vaddq_u32(x6, in6);
-        x7  = vaddq_u32(x7, in7);
-        x8  = vaddq_u32(x8, in8);
-        x9  = vaddq_u32(x9, in9);
-        x10 = vaddq_u32(x10, in10);
-        x11 = vaddq_u32(x11, in11);
-        x12 = vaddq_u32(x12, in12);
-        x13 = vaddq_u32(x13, in13);
-        x14 = vaddq_u32(x14, in14);
-        x15 = vaddq_u32(x15, in15);
-        // Gather into array of 16 vectors
-        uint32x4_t xs[16] = {x0,x1,x2,x3,x4,x5,x6,x7,x8,x9,x10,x11,x12,x13,x14,x15};
-        // Extract lanes for each of 4 streams
-        for (int w = 0; w < 16; w++) {
-            store32_le(ks[0] + 4*w, vgetq_lane_u32(xs[w], 0));
-            store32_le(ks[1] + 4*w, vgetq_lane_u32(xs[w], 1));
-            store32_le(ks[2] + 4*w, vgetq_lane_u32(xs[w], 2));
-            store32_le(ks[3] + 4*w, vgetq_lane_u32(xs[w], 3));
+    while (len >= 512) {
+        // x[0..15] is state a (blocks 0–3), x[16..31] state b (blocks 4–7)
+        uint32x4_t x[32], xin[32];
+        uint32_t state_b[16];
+        memcpy(state_b, state, sizeof(state_b));
+        chacha20_ctr_add(state_b, 4, ctr64);
+        arx_neon_init(xin, state, 12, ctr64);
+        arx_neon_init(xin + 16, state_b, 12, ctr64);
+        for (int w = 0; w < 32; w++) x[w] = xin[w];
+        // `rounds` rounds, the two states interleaved quarter round by quarter round
+        CHACHA_UNROLL
+        for (int i = 0; i < rounds; i += 2) {
+            CHACHA_DOUBLEROUND(NEON_QR_X2, x);
         }
-        // XOR 4 blocks
-        for (int k = 0; k < 4; k++) {
-            for (int i = 0; i < 64; i++) {
-                out[off + k*64 + i] = in[off + k*64 + i] ^ ks[k][i];
-            }
-        }
-        off += 256;
-        len -= 256;
-        counter += 4;
+        arx_neon_xor_out(out + off, in + off, x, xin);
+        arx_neon_xor_out(out + off + 256, in + off + 256, x + 16, xin + 16);
+        off += 512;
+        len -= 512;
+        chacha20_ctr_add(state, 8, ctr64);
     }
     // Tail fallback
     if (len > 0) {
-        chacha20_xor_interleaved4(out + off, in + off, len, key, nonce, counter);
+        chacha_blocks_neon4(out + off, in + off, len, state, ctr64, rounds);
+    }
+}
+
+CHACHA_KERNEL_VARIANTS(neon8, )
+
+// NEON 8-way SIMD path, one-shot API
+void chacha20_xor_neon8(uint8_t *out, const uint8_t *in, size_t len,
+                        const uint8_t key[32], const uint8_t nonce[12],
+                        uint32_t counter) {
+    uint32_t state[16];
+    chacha20_init_state(state, key, nonce, counter);
+    chacha_blocks_neon8(out, in, len, state, 0, 20);
+}
+#endif
+
+#if HAVE_X86
+// SSE2/SSSE3 rotates:
+//   The 16- and 8-bit rotates move whole bytes, so a single pshufb with a
+//   constant shuffle mask replaces the shift/shift/or triple. The 12- and
+//   7-bit rotates still need the shift/or pair.
+#define SSE_ROTL16(v) SSSE3_ROTL16(v)
+#define SSE_ROTL8(v)  SSSE3_ROTL8(v)
+#define SSE_ROTL12(v) SSE_ROTL(v, 12)
+#define SSE_ROTL7(v)  SSE_ROTL(v, 7)
+
+// SSE_QR(a, b, c, d):
+//   Same quarter round as NEON_QR, on 4 lanes of __m128i.
+#define SSE_QR(a, b, c, d)             \
+    do {                               \
+        a = _mm_add_epi32(a, b);       \
+        d = _mm_xor_si128(d, a);       \
+        d = SSE_ROTL16(d);             \
+        c = _mm_add_epi32(c, d);       \
+        b = _mm_xor_si128(b, c);       \
+        b = SSE_ROTL12(b);             \
+        a = _mm_add_epi32(a, b);       \
+        d = _mm_xor_si128(d, a);       \
+        d = SSE_ROTL8(d);              \
+        c = _mm_add_epi32(c, d);       \
+        b = _mm_xor_si128(b, c);       \
+        b = SSE_ROTL7(b);              \
+    } while (0)
+
+//chacha20_xor_ssse3(out, in, len, …):
+//  x86 counterpart of chacha20_xor_neon4: 16 __m128i registers, one ChaCha
+//  word per register and one block per lane, 4 blocks (256 bytes) per pass.
+//  Instead of spilling lanes to a scratch buffer the state is transposed in
+//  registers and XORed 16 bytes at a time against unaligned in/out.
+ARX_KERNEL(chacha_blocks_ssse3, sse, __m128i, 4, __attribute__((target("ssse3"))),
+           CHACHA_DOUBLEROUND, SSE_QR, CHACHA_CTR_WORD, chacha_blocks_interleaved4)
+
+CHACHA_KERNEL_VARIANTS(ssse3, __attribute__((target("ssse3"))))
+
+// SSSE3 4-way SIMD path, one-shot API
+void chacha20_xor_ssse3(uint8_t *out, const uint8_t *in, size_t len,
+                        const uint8_t key[32], const uint8_t nonce[12],
+                        uint32_t counter) {
+    uint32_t state[16];
+    chacha20_init_state(state, key, nonce, counter);
+    chacha_blocks_ssse3(out, in, len, state, 0, 20);
+}
+
+// AVX2 rotates: identical to the SSE ones, 8 lanes wide (AVX2_ROTL16 and
+// AVX2_ROTL8 come from arx_simd.h).
+#define AVX2_ROTL12(v) AVX2_ROTL(v, 12)
+#define AVX2_ROTL7(v)  AVX2_ROTL(v, 7)
+
+#define AVX2_QR(a, b, c, d)            \
+    do {                               \
+        a = _mm256_add_epi32(a, b);    \
+        d = _mm256_xor_si256(d, a);    \
+        d = AVX2_ROTL16(d);            \
+        c = _mm256_add_epi32(c, d);    \
+        b = _mm256_xor_si256(b, c);    \
+        b = AVX2_ROTL12(b);            \
+        a = _mm256_add_epi32(a, b);    \
+        d = _mm256_xor_si256(d, a);    \
+        d = AVX2_ROTL8(d);             \
+        c = _mm256_add_epi32(c, d);    \
+        b = _mm256_xor_si256(b, c);    \
+        b = AVX2_ROTL7(b);             \
+    } while (0)
+
+//chacha20_xor_avx2(out, in, len, …):
+//  8-way ChaCha20 using 16 __m256i registers (512 bytes per pass). After the
+//  per-half transpose, vperm2i128 joins the word groups 0–7 / 8–15 of one
+//  block into 32-byte rows that are XORed directly against in/out.
+//  Tails shorter than 512 bytes go through the 4-way SSSE3 kernel.
+ARX_KERNEL(chacha_blocks_avx2, avx2, __m256i, 8, __attribute__((target("avx2"))),
+           CHACHA_DOUBLEROUND, AVX2_QR, CHACHA_CTR_WORD, chacha_blocks_ssse3)
+
+CHACHA_KERNEL_VARIANTS(avx2, __attribute__((target("avx2"))))
+
+// AVX2 8-way SIMD path, one-shot API
+void chacha20_xor_avx2(uint8_t *out, const uint8_t *in, size_t len,
+                       const uint8_t key[32], const uint8_t nonce[12],
+                       uint32_t counter) {
+    uint32_t state[16];
+    chacha20_init_state(state, key, nonce, counter);
+    chacha_blocks_avx2(out, in, len, state, 0, 20);
+}
+
+// AVX-512F quarter round: vprold rotates every amount natively, so all four
+// rotates are a single instruction and no pshufb masks are needed.
+#define AVX512_QR(a, b, c, d)          \
+    do {                               \
+        a = _mm512_add_epi32(a, b);    \
+        d = _mm512_xor_si512(d, a);    \
+        d = AVX512_ROTL(d, 16);        \
+        c = _mm512_add_epi32(c, d);    \
+        b = _mm512_xor_si512(b, c);    \
+        b = AVX512_ROTL(b, 12);        \
+        a = _mm512_add_epi32(a, b);    \
+        d = _mm512_xor_si512(d, a);    \
+        d = AVX512_ROTL(d, 8);         \
+        c = _mm512_add_epi32(c, d);    \
+        b = _mm512_xor_si512(b, c);    \
+        b = AVX512_ROTL(b, 7);         \
+    } while (0)
+
+//chacha20_xor_avx512(out, in, len, …):
+//  16-way ChaCha20 on 16 zmm registers, 1 KiB per pass. After the two
+//  transpose stages every zmm holds one whole keystream block, so the
+//  XOR-out is one 64-byte load/xor/store per block. Tails below 1 KiB are
+//  passed down to the AVX2 kernel.
+ARX_KERNEL(chacha_blocks_avx512, avx512, __m512i, 16, __attribute__((target("avx512f"))),
+           CHACHA_DOUBLEROUND, AVX512_QR, CHACHA_CTR_WORD, chacha_blocks_avx2)
+
+CHACHA_KERNEL_VARIANTS(avx512, __attribute__((target("avx512f"))))
+
+// AVX-512 16-way SIMD path, one-shot API
+void chacha20_xor_avx512(uint8_t *out, const uint8_t *in, size_t len,
+                         const uint8_t key[32], const uint8_t nonce[12],
+                         uint32_t counter) {
+    uint32_t state[16];
+    chacha20_init_state(state, key, nonce, counter);
+    chacha_blocks_avx512(out, in, len, state, 0, 20);
+}
+
+// x86 feature levels detected once through CPUID
+enum { CHACHA_X86_SCALAR = 0, CHACHA_X86_SSSE3, CHACHA_X86_AVX2, CHACHA_X86_AVX512 };
+
+// Shortest message handed to the AVX-512 kernel. Below this the 512-bit
+// license transition (lower clocks for the following few hundred µs) costs
+// more than the wider kernel saves, so short messages stay on AVX2.
+#ifndef CHACHA20_AVX512_MIN_LEN
+#define CHACHA20_AVX512_MIN_LEN 16384
+#endif
+
+static int chacha20_x86_level(void) {
+    static int level = -1;
+    if (level < 0) {
+        int l = CHACHA_X86_SCALAR;
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("ssse3")) l = CHACHA_X86_SSSE3;
+        if (__builtin_cpu_supports("avx2"))  l = CHACHA_X86_AVX2;
+        if (l == CHACHA_X86_AVX2 && __builtin_cpu_supports("avx512f"))
+            l = CHACHA_X86_AVX512;
+        level = l;
     }
+    return level;
 }
 #endif
 
 //chacha20_xor_best(...):
 //  Runtime dispatcher that selects the fastest path:
-//    • NEON 4-way SIMD if available
+//    • NEON 8-way (two interleaved 4-way states) if available
+//    • on x86, AVX-512 16-way (only for len >= CHACHA20_AVX512_MIN_LEN),
+//      AVX2 8-way or SSSE3 4-way, chosen at runtime via CPUID
 //    • otherwise 4-way interleaved scalar
 //  Provides a single API for encryption/decryption without burdening callers
 //  with hardware-specific details.
-// This function is the entry point for users, automatically choosing the best implementation.
-// It checks for NEON support and calls the appropriate function based on availability.
-// It abstracts away the complexity of choosing between SIMD and scalar paths,
-// allowing users to simply call this function without worrying about the underlying details.
-// Dispatcher: choose NEON path or scalar interleaved
+//  The choice is made from chacha_paths: the widest path the CPU supports
+//  whose min_len the message reaches. The defaults reproduce the rules
+//  above; chacha20_autotune replaces them with thresholds measured on this
+//  machine.
+typedef void (*chacha_blocks_fn)(uint8_t *out, const uint8_t *in, size_t len,
+                                 uint32_t state[16], int ctr64, int rounds);
+
+typedef struct {
+    const char *name;
+    chacha_blocks_fn fn;
+    size_t min_len;     // shortest message this path is picked for
+} chacha_path;
+
+// Narrowest first; on x86 the index equals the CHACHA_X86_* level needed
+static chacha_path chacha_paths[] = {
+    { "interleaved4", chacha_blocks_interleaved4, 0 },
+#if HAVE_NEON
+    { "neon4",        chacha_blocks_neon4,        0 },
+    { "neon8",        chacha_blocks_neon8,        0 },
+#elif HAVE_X86
+    { "ssse3",        chacha_blocks_ssse3,        0 },
+    { "avx2",         chacha_blocks_avx2,         0 },
+    { "avx512",       chacha_blocks_avx512,       CHACHA20_AVX512_MIN_LEN },
+#endif
+};
+#define CHACHA_NPATHS (sizeof(chacha_paths) / sizeof(chacha_paths[0]))
+
+// Index of the widest path this CPU can run
+static size_t chacha_path_top(void) {
+#if !HAVE_NEON && HAVE_X86
+    return (size_t)chacha20_x86_level();
+#else
+    return CHACHA_NPATHS - 1;
+#endif
+}
+
+static size_t chacha_path_for(size_t len) {
+    size_t i = chacha_path_top();
+    while (i > 0 && len < chacha_paths[i].min_len) {
+        i--;
+    }
+    return i;
+}
+
+static void chacha_blocks_best(uint8_t *out, const uint8_t *in, size_t len,
+                               uint32_t state[16], int ctr64, int rounds) {
+    chacha_paths[chacha_path_for(len)].fn(out, in, len, state, ctr64, rounds);
+}
+
+//chacha20_autotune(cache_path):
+//  One-time calibration of chacha_paths[].min_len. Every path this CPU
+//  supports is timed on messages of 64 B … 64 KiB (best of
+//  CHACHA_TUNE_RUNS runs of ~64 KiB each); a path's threshold is the
+//  smallest size from which it is at least as fast as every narrower path
+//  at that size and all larger ones, so a longer message never lands on a
+//  slower kernel. The AVX-512 threshold is kept at or above
+//  CHACHA20_AVX512_MIN_LEN, since the clock drop it guards against hurts
+//  the code around the call and does not show in a micro-benchmark.
+//  With a cache_path the thresholds are read from that file when it was
+//  written on the same CPU model, and written there after a calibration,
+//  so later processes start without measuring. Call it at startup, before
+//  other threads use chacha20_xor_best.
+//  Returns 0 when loaded from the cache, 1 after calibrating, -1 when the
+//  new thresholds (which are in effect anyway) could not be saved.
+#define CHACHA_TUNE_MIN   64
+#define CHACHA_TUNE_MAX   65536
+#define CHACHA_TUNE_RUNS  5
+#define CHACHA_TUNE_SIZES 11    // 64 B .. 64 KiB, doubling
+
+// Identifies the machine the cache was written on
+static void chacha_tune_signature(char *sig, size_t n) {
+#if HAVE_X86
+    unsigned r[12] = {0}, eax = 0, ebx, ecx, edx;
+    char brand[49] = {0};
+    if (__get_cpuid(0x80000000u, &eax, &ebx, &ecx, &edx) && eax >= 0x80000004u) {
+        for (unsigned i = 0; i < 3; i++) {
+            __get_cpuid(0x80000002u + i, &r[4*i], &r[4*i + 1], &r[4*i + 2], &r[4*i + 3]);
+        }
+        memcpy(brand, r, 48);
+    }
+    __get_cpuid(1, &eax, &ebx, &ecx, &edx);
+    for (char *c = brand; *c; c++) {
+        if (*c == ' ') *c = '_';   // one token per field in the cache file
+    }
+    snprintf(sig, n, "x86-%08x-%s", eax, brand[0] ? brand : "unknown");
+#elif HAVE_NEON
+    snprintf(sig, n, "neon-%u", (unsigned)CHACHA_NPATHS);
+#else
+    snprintf(sig, n, "generic");
+#endif
+}
+
+static double chacha_tune_now(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// Best time per byte of one path at one size
+static double chacha_tune_measure(chacha_blocks_fn fn, uint8_t *buf, size_t size) {
+    static const uint8_t key[32] = {1}, nonce[12] = {2};
+    uint32_t state[16];
+    size_t iters = CHACHA_TUNE_MAX / size;
+    double best = 1e30;
+    chacha20_init_state(state, key, nonce, 0);
+    fn(buf, buf, size, state, 0, 20);   // warm-up
+    for (int r = 0; r < CHACHA_TUNE_RUNS; r++) {
+        double t0 = chacha_tune_now();
+        for (size_t i = 0; i < iters; i++) {
+            fn(buf, buf, size, state, 0, 20);
+        }
+        double t = (chacha_tune_now() - t0) / (double)(iters * size);
+        if (t < best) best = t;
+    }
+    return best;
+}
+
+static int chacha_tune_load(const char *path, const char *sig) {
+    FILE *f = fopen(path, "r");
+    if (f == NULL) return -1;
+    char fsig[160], name[32];
+    unsigned long long v;
+    size_t loaded[CHACHA_NPATHS] = {0};
+    size_t seen = 0;
+    int ok = fscanf(f, "chacha20-tune 1 %159s", fsig) == 1 && strcmp(fsig, sig) == 0;
+    while (ok && fscanf(f, "%31s %llu", name, &v) == 2) {
+        for (size_t i = 0; i < CHACHA_NPATHS; i++) {
+            if (strcmp(name, chacha_paths[i].name) == 0) {
+                loaded[i] = (size_t)v;
+                seen |= (size_t)1 << i;
+            }
+        }
+    }
+    fclose(f);
+    if (!ok || seen != ((size_t)1 << CHACHA_NPATHS) - 1) return -1;
+    for (size_t i = 0; i < CHACHA_NPATHS; i++) {
+        chacha_paths[i].min_len = loaded[i];
+    }
+    return 0;
+}
+
+static int chacha_tune_save(const char *path, const char *sig) {
+    char tmp[4096];
+    if (snprintf(tmp, sizeof(tmp), "%s.tmp", path) >= (int)sizeof(tmp)) return -1;
+    FILE *f = fopen(tmp, "w");
+    if (f == NULL) return -1;
+    fprintf(f, "chacha20-tune 1 %s\n", sig);
+    for (size_t i = 0; i < CHACHA_NPATHS; i++) {
+        fprintf(f, "%s %llu\n", chacha_paths[i].name,
+                (unsigned long long)chacha_paths[i].min_len);
+    }
+    // rename() makes the new file appear whole to concurrent readers
+    if (fclose(f) != 0 || rename(tmp, path) != 0) {
+        remove(tmp);
+        return -1;
+    }
+    return 0;
+}
+
+int chacha20_autotune(const char *cache_path) {
+    char sig[128];
+    chacha_tune_signature(sig, sizeof(sig));
+    if (cache_path != NULL && chacha_tune_load(cache_path, sig) == 0) {
+        return 0;
+    }
+
+    static uint8_t buf[CHACHA_TUNE_MAX] __attribute__((aligned(64)));
+    double t[CHACHA_NPATHS][CHACHA_TUNE_SIZES];
+    size_t top = chacha_path_top();
+    for (size_t i = 0; i <= top; i++) {
+        for (int k = 0; k < CHACHA_TUNE_SIZES; k++) {
+            t[i][k] = chacha_tune_measure(chacha_paths[i].fn, buf, (size_t)CHACHA_TUNE_MIN << k);
+        }
+    }
+    chacha_paths[0].min_len = 0;
+    for (size_t i = 1; i <= top; i++) {
+        // Walk down from the largest size while path i still wins
+        int from = CHACHA_TUNE_SIZES;
+        for (int k = CHACHA_TUNE_SIZES - 1; k >= 0; k--) {
+            int wins = 1;
+            for (size_t j = 0; j < i; j++) {
+                wins &= t[i][k] <= t[j][k];
+            }
+            if (!wins) break;
+            from = k;
+        }
+        size_t min_len = from == CHACHA_TUNE_SIZES ? SIZE_MAX : (size_t)CHACHA_TUNE_MIN << from;
+        if (from == 0) min_len = 0;   // wins at every size measured
+#if !HAVE_NEON && HAVE_X86
+        if (i == CHACHA_X86_AVX512 && min_len < CHACHA20_AVX512_MIN_LEN) {
+            min_len = CHACHA20_AVX512_MIN_LEN;
+        }
+#endif
+        chacha_paths[i].min_len = min_len;
+    }
+    memset(buf, 0, sizeof(buf));
+    if (cache_path != NULL && chacha_tune_save(cache_path, sig) != 0) {
+        return -1;
+    }
+    return 1;
+}
+
+// Name of the path chacha20_xor_best uses for a message of len bytes
+const char *chacha20_path_for_len(size_t len) {
+    return chacha_paths[chacha_path_for(len)].name;
+}
+
 void chacha20_xor_best(uint8_t *out, const uint8_t *in, size_t len,
                        const uint8_t key[32], const uint8_t nonce[12],
                        uint32_t counter) {
+    uint32_t state[16];
+    chacha20_init_state(state, key, nonce, counter);
+    chacha_blocks_best(out, in, len, state, 0, 20);
+}
+
+//chacha20_djb_xor(out, in, len, key, nonce, counter):
+//  64-bit counter / 64-bit nonce variant of chacha20_xor_best. The counter
+//  carries from word 12 into word 13 in every kernel, so one nonce covers a
+//  stream of up to 2^70 bytes without re-keying.
+void chacha20_djb_xor(uint8_t *out, const uint8_t *in, size_t len,
+                      const uint8_t key[32], const uint8_t nonce[8],
+                      uint64_t counter) {
+    uint32_t state[16];
+    chacha20_djb_init_state(state, key, nonce, counter);
+    chacha_blocks_best(out, in, len, state, 1, 20);
+}
+
+//chacha8_xor / chacha12_xor:
+//  ChaCha with 8 and 12 rounds on the same dispatcher and kernels, each
+//  instance fully unrolled. Roughly 2.5x / 1.6x the speed of ChaCha20; meant
+//  for non-adversarial bulk randomness (test data, shuffling), not for
+//  protecting data.
+#define CHACHA_DEFINE_REDUCED_XOR(R)                                            \
+    void chacha##R##_xor(uint8_t *out, const uint8_t *in, size_t len,           \
+                         const uint8_t key[32], const uint8_t nonce[12],        \
+                         uint32_t counter) {                                    \
+        uint32_t state[16];                                                     \
+        chacha20_init_state(state, key, nonce, counter);                        \
+        chacha_blocks_best(out, in, len, state, 0, R);                          \
+    }
+
+CHACHA_DEFINE_REDUCED_XOR(8)
+CHACHA_DEFINE_REDUCED_XOR(12)
+
+//chacha20_xor_batch(msgs, n):
+//  Many short messages, each with its own key, nonce and counter, one
+//  message per SIMD lane. The per-lane states live word-major in
+//  soa[word][lane], so a kernel pass loads each input vector with a single
+//  load instead of broadcasting one state, runs the rounds once for all
+//  lanes and writes lane k's keystream block straight to message k. A lane
+//  whose message has ended is refilled with the next queued message, so
+//  lanes of different lengths never wait for each other; a lane holding the
+//  last partial block of its message (or nothing at all) is pointed at a
+//  scratch block instead. Messages of CHACHA20_BATCH_BULK_LEN bytes and more
+//  go through chacha_blocks_best on their own, and once fewer than half the
+//  lanes have work the remainders are finished the same way.
+#ifndef CHACHA20_BATCH_BULK_LEN
+#define CHACHA20_BATCH_BULK_LEN 4096
+#endif
+#define CHACHA_BATCH_MAX_LANES 16
+
+typedef uint32_t chacha_batch_soa[16][CHACHA_BATCH_MAX_LANES];
+
+// One pass: a block of keystream per lane, XORed from src[k] into dst[k],
+// then every lane's counter (soa[12]) moves on by one block
+typedef void (*chacha_batch_kernel)(chacha_batch_soa soa, uint8_t *const dst[],
+                                    const uint8_t *const src[]);
+
+// Scalar reference pass for a single lane
+__attribute__((unused))
+static void chacha_batch_scalar(chacha_batch_soa soa, uint8_t *const dst[],
+                                const uint8_t *const src[]) {
+    uint32_t st[16];
+    uint8_t ks[64];
+    for (int w = 0; w < 16; w++) {
+        st[w] = soa[w][0];
+    }
+    chacha20_block(ks, st);
+    for (int i = 0; i < 64; i++) {
+        dst[0][i] = src[0][i] ^ ks[i];
+    }
+    soa[12][0]++;
+}
+
+#if HAVE_NEON
+// NEON: 4 lanes
+static void chacha_batch_neon4(chacha_batch_soa soa, uint8_t *const dst[],
+                               const uint8_t *const src[]) {
+    uint32x4_t in[16], x[16];
+    for (int w = 0; w < 16; w++) {
+        in[w] = vld1q_u32(soa[w]);
+        x[w] = in[w];
+    }
+    CHACHA_UNROLL
+    for (int i = 0; i < 20; i += 2) {
+        CHACHA_DOUBLEROUND(NEON_QR, x);
+    }
+    for (int w = 0; w < 16; w++) {
+        x[w] = vaddq_u32(x[w], in[w]);
+    }
+    for (int g = 0; g < 16; g += 4) {
+        NEON_TRANSPOSE4(x[g], x[g + 1], x[g + 2], x[g + 3]);
+    }
+    // x[4*g + k] = bytes 16*g..16*g+15 of lane k
+    for (int k = 0; k < 4; k++) {
+        for (int g = 0; g < 4; g++) {
+            uint8x16_t m = vld1q_u8(src[k] + g*16);
+            vst1q_u8(dst[k] + g*16, veorq_u8(m, vreinterpretq_u8_u32(x[4*g + k])));
+        }
+    }
+    vst1q_u32(soa[12], vaddq_u32(in[12], vdupq_n_u32(1)));
+}
+#endif
+
+#if HAVE_X86
+// SSSE3: 4 lanes, same rounds and transpose as chacha_blocks_ssse3_tmpl
+__attribute__((target("ssse3")))
+static void chacha_batch_ssse3(chacha_batch_soa soa, uint8_t *const dst[],
+                               const uint8_t *const src[]) {
+    __m128i in[16], x[16];
+    for (int w = 0; w < 16; w++) {
+        in[w] = _mm_loadu_si128((const __m128i *)soa[w]);
+        x[w] = in[w];
+    }
+    CHACHA_UNROLL
+    for (int i = 0; i < 20; i += 2) {
+        CHACHA_DOUBLEROUND(SSE_QR, x);
+    }
+    for (int w = 0; w < 16; w++) {
+        x[w] = _mm_add_epi32(x[w], in[w]);
+    }
+    SSE_TRANSPOSE4(x[0],  x[1],  x[2],  x[3]);
+    SSE_TRANSPOSE4(x[4],  x[5],  x[6],  x[7]);
+    SSE_TRANSPOSE4(x[8],  x[9],  x[10], x[11]);
+    SSE_TRANSPOSE4(x[12], x[13], x[14], x[15]);
+    // x[4*g + k] = bytes 16*g..16*g+15 of lane k
+    for (int k = 0; k < 4; k++) {
+        for (int g = 0; g < 4; g++) {
+            __m128i m = _mm_loadu_si128((const __m128i *)(src[k] + g*16));
+            _mm_storeu_si128((__m128i *)(dst[k] + g*16), _mm_xor_si128(m, x[4*g + k]));
+        }
+    }
+    _mm_storeu_si128((__m128i *)soa[12], _mm_add_epi32(in[12], _mm_set1_epi32(1)));
+}
+
+// AVX2: 8 lanes, rows joined with vperm2i128 as in chacha_blocks_avx2_tmpl
+__attribute__((target("avx2")))
+static void chacha_batch_avx2(chacha_batch_soa soa, uint8_t *const dst[],
+                              const uint8_t *const src[]) {
+    __m256i in[16], x[16];
+    for (int w = 0; w < 16; w++) {
+        in[w] = _mm256_loadu_si256((const __m256i *)soa[w]);
+        x[w] = in[w];
+    }
+    CHACHA_UNROLL
+    for (int i = 0; i < 20; i += 2) {
+        CHACHA_DOUBLEROUND(AVX2_QR, x);
+    }
+    for (int w = 0; w < 16; w++) {
+        x[w] = _mm256_add_epi32(x[w], in[w]);
+    }
+    AVX2_TRANSPOSE4(x[0],  x[1],  x[2],  x[3]);
+    AVX2_TRANSPOSE4(x[4],  x[5],  x[6],  x[7]);
+    AVX2_TRANSPOSE4(x[8],  x[9],  x[10], x[11]);
+    AVX2_TRANSPOSE4(x[12], x[13], x[14], x[15]);
+    for (int k = 0; k < 4; k++) {
+        __m256i r0 = _mm256_permute2x128_si256(x[k],     x[4 + k],  0x20); // lane k,   bytes  0..31
+        __m256i r1 = _mm256_permute2x128_si256(x[8 + k], x[12 + k], 0x20); // lane k,   bytes 32..63
+        __m256i r2 = _mm256_permute2x128_si256(x[k],     x[4 + k],  0x31); // lane k+4, bytes  0..31
+        __m256i r3 = _mm256_permute2x128_si256(x[8 + k], x[12 + k], 0x31); // lane k+4, bytes 32..63
+        _mm256_storeu_si256((__m256i *)dst[k],
+            _mm256_xor_si256(r0, _mm256_loadu_si256((const __m256i *)src[k])));
+        _mm256_storeu_si256((__m256i *)(dst[k] + 32),
+            _mm256_xor_si256(r1, _mm256_loadu_si256((const __m256i *)(src[k] + 32))));
+        _mm256_storeu_si256((__m256i *)dst[k + 4],
+            _mm256_xor_si256(r2, _mm256_loadu_si256((const __m256i *)src[k + 4])));
+        _mm256_storeu_si256((__m256i *)(dst[k + 4] + 32),
+            _mm256_xor_si256(r3, _mm256_loadu_si256((const __m256i *)(src[k + 4] + 32))));
+    }
+    _mm256_storeu_si256((__m256i *)soa[12], _mm256_add_epi32(in[12], _mm256_set1_epi32(1)));
+}
+
+// AVX-512: 16 lanes, one zmm per lane after the two transpose stages
+__attribute__((target("avx512f")))
+static void chacha_batch_avx512(chacha_batch_soa soa, uint8_t *const dst[],
+                                const uint8_t *const src[]) {
+    __m512i in[16], x[16];
+    for (int w = 0; w < 16; w++) {
+        in[w] = _mm512_loadu_si512((const void *)soa[w]);
+        x[w] = in[w];
+    }
+    CHACHA_UNROLL
+    for (int i = 0; i < 20; i += 2) {
+        CHACHA_DOUBLEROUND(AVX512_QR, x);
+    }
+    for (int w = 0; w < 16; w++) {
+        x[w] = _mm512_add_epi32(x[w], in[w]);
+    }
+    AVX512_TRANSPOSE4(x[0],  x[1],  x[2],  x[3]);
+    AVX512_TRANSPOSE4(x[4],  x[5],  x[6],  x[7]);
+    AVX512_TRANSPOSE4(x[8],  x[9],  x[10], x[11]);
+    AVX512_TRANSPOSE4(x[12], x[13], x[14], x[15]);
+    AVX512_TRANSPOSE128(x[0], x[4], x[8],  x[12]);
+    AVX512_TRANSPOSE128(x[1], x[5], x[9],  x[13]);
+    AVX512_TRANSPOSE128(x[2], x[6], x[10], x[14]);
+    AVX512_TRANSPOSE128(x[3], x[7], x[11], x[15]);
+    for (int k = 0; k < 16; k++) {
+        __m512i m = _mm512_loadu_si512((const void *)src[k]);
+        _mm512_storeu_si512((void *)dst[k], _mm512_xor_si512(m, x[k]));
+    }
+    _mm512_storeu_si512((void *)soa[12], _mm512_add_epi32(in[12], _mm512_set1_epi32(1)));
+}
+#endif
+
+// Load message m into lane k of the word-major state
+static void chacha_batch_load(chacha_batch_soa soa, int k, const chacha20_msg *m) {
+    uint32_t st[16];
+    chacha20_init_state(st, m->key, m->nonce, m->counter);
+    for (int w = 0; w < 16; w++) {
+        soa[w][k] = st[w];
+    }
+    arx_wipe(st, sizeof(st));
+}
+
+static void chacha_batch_run(const chacha20_msg *msgs, size_t n,
+                             chacha_batch_kernel kernel, int lanes) {
+    static const uint8_t zero[64];
+    _Alignas(64) chacha_batch_soa soa;
+    uint8_t scratch[CHACHA_BATCH_MAX_LANES][64];
+    const chacha20_msg *cur[CHACHA_BATCH_MAX_LANES];
+    size_t pos[CHACHA_BATCH_MAX_LANES];
+    uint8_t *dst[CHACHA_BATCH_MAX_LANES];
+    const uint8_t *src[CHACHA_BATCH_MAX_LANES];
+    size_t next = 0;
+    int active = 0;
+
+    memset(soa, 0, sizeof(soa));
+    for (int k = 0; k < lanes; k++) {
+        cur[k] = NULL;
+        pos[k] = 0;
+    }
+    for (;;) {
+        // Refill idle lanes from the queue; long messages bypass the lanes
+        for (int k = 0; k < lanes && next < n; k++) {
+            while (cur[k] == NULL && next < n) {
+                const chacha20_msg *m = &msgs[next++];
+                if (m->len >= CHACHA20_BATCH_BULK_LEN) {
+                    chacha20_xor_best(m->out, m->in, m->len, m->key, m->nonce, m->counter);
+                } else if (m->len > 0) {
+                    chacha_batch_load(soa, k, m);
+                    cur[k] = m;
+                    pos[k] = 0;
+                    active++;
+                }
+            }
+        }
+        if (active == 0 || (next == n && 2 * active < lanes)) {
+            break;
+        }
+        for (int k = 0; k < lanes; k++) {
+            if (cur[k] != NULL && cur[k]->len - pos[k] >= 64) {
+                dst[k] = cur[k]->out + pos[k];
+                src[k] = cur[k]->in + pos[k];
+            } else {
+                dst[k] = scratch[k];
+                src[k] = zero;
+            }
+        }
+        kernel(soa, dst, src);
+        for (int k = 0; k < lanes; k++) {
+            const chacha20_msg *m = cur[k];
+            if (m == NULL) {
+                continue;
+            }
+            size_t rem = m->len - pos[k];
+            if (rem > 64) {
+                pos[k] += 64;
+                continue;
+            }
+            // Last partial block: its keystream is in scratch[k]
+            if (rem < 64) {
+                for (size_t i = 0; i < rem; i++) {
+                    m->out[pos[k] + i] = m->in[pos[k] + i] ^ scratch[k][i];
+                }
+            }
+            cur[k] = NULL;
+            active--;
+        }
+    }
+    // Too few lanes left busy: finish each remainder on its own
+    for (int k = 0; k < lanes; k++) {
+        if (cur[k] != NULL) {
+            uint32_t st[16];
+            for (int w = 0; w < 16; w++) {
+                st[w] = soa[w][k];
+            }
+            chacha_blocks_best(cur[k]->out + pos[k], cur[k]->in + pos[k],
+                               cur[k]->len - pos[k], st, 0, 20);
+            arx_wipe(st, sizeof(st));
+        }
+    }
+    // The state holds the keys, scratch the keystream of partial blocks
+    arx_wipe(soa, sizeof(soa));
+    arx_wipe(scratch, (size_t)lanes * sizeof(scratch[0]));
+}
+
+void chacha20_xor_batch(const chacha20_msg *msgs, size_t n) {
 #if HAVE_NEON
-    chacha20_xor_neon4(out, in, len, key, nonce, counter);
+    chacha_batch_run(msgs, n, chacha_batch_neon4, 4);
+#elif HAVE_X86
+    size_t total = 0;
+    switch (chacha20_x86_level()) {
+    case CHACHA_X86_AVX512:
+        // Same license rule as chacha_blocks_best, on the batch as a whole
+        for (size_t i = 0; i < n && total < CHACHA20_AVX512_MIN_LEN; i++) {
+            total += msgs[i].len;
+        }
+        if (total >= CHACHA20_AVX512_MIN_LEN) {
+            chacha_batch_run(msgs, n, chacha_batch_avx512, 16);
+            break;
+        }
+        chacha_batch_run(msgs, n, chacha_batch_avx2, 8);
+        break;
+    case CHACHA_X86_AVX2:
+        chacha_batch_run(msgs, n, chacha_batch_avx2, 8);
+        break;
+    case CHACHA_X86_SSSE3:
+        chacha_batch_run(msgs, n, chacha_batch_ssse3, 4);
+        break;
+    default:
+        chacha_batch_run(msgs, n, chacha_batch_scalar, 1);
+        break;
+    }
 #else
-    chacha20_xor_interleaved4(out, in, len, key, nonce, counter);
+    chacha_batch_run(msgs, n, chacha_batch_scalar, 1);
 #endif
 }
 
+//chacha20_init / chacha20_update / chacha20_final:
+//  Streaming API for data that arrives in fragments of arbitrary size.
+//    • init expands key, nonce and counter into ctx->state once
+//    • update first spends keystream left over from the previous call, then
+//      runs whole blocks through the same kernels as chacha20_xor_best, and
+//      finally generates one more block for a trailing partial block and
+//      keeps its unused bytes in ctx->ks for the next update
+//    • seek repositions the stream at any byte offset (see below)
+//    • final wipes the key material from the context
+//  Feeding a message through any sequence of updates gives exactly the same
+//  output as one chacha20_xor_best call over the whole message.
+void chacha20_init(chacha20_ctx *ctx, const uint8_t key[32],
+                   const uint8_t nonce[12], uint32_t counter) {
+    chacha20_init_state(ctx->state, key, nonce, counter);
+    ctx->counter0 = counter;
+    ctx->ctr64 = 0;
+    ctx->ks_used = sizeof(ctx->ks); // no buffered keystream yet
+}
+
+// Same, for the 64-bit counter / 64-bit nonce layout
+void chacha20_djb_init(chacha20_ctx *ctx, const uint8_t key[32],
+                       const uint8_t nonce[8], uint64_t counter) {
+    chacha20_djb_init_state(ctx->state, key, nonce, counter);
+    ctx->counter0 = counter;
+    ctx->ctr64 = 1;
+    ctx->ks_used = sizeof(ctx->ks);
+}
+
+//chacha20_seek(ctx, byte_offset):
+//  Move the stream to byte_offset, counted from the start of the stream set
+//  up by chacha20_init. The offset splits into a block index (offset / 64),
+//  added to the initial counter, and a position inside that block
+//  (offset % 64). For a non-zero in-block position the block is generated
+//  right away and its first bytes are marked as used, so the next update
+//  continues mid-block. Like chacha20_xor the 32-bit RFC 8439 counter
+//  wraps, so there offsets are unique only within 256 GiB of the initial
+//  counter; a context from chacha20_djb_init covers the full 64-bit range.
+void chacha20_seek(chacha20_ctx *ctx, uint64_t byte_offset) {
+    size_t in_block = (size_t)(byte_offset & 63);
+    uint64_t block = ctx->counter0 + (byte_offset >> 6);
+    ctx->state[12] = (uint32_t)block;
+    if (ctx->ctr64) {
+        ctx->state[13] = (uint32_t)(block >> 32);
+    }
+    ctx->ks_used = sizeof(ctx->ks);
+    if (in_block > 0) {
+        chacha20_block(ctx->ks, ctx->state);
+        chacha20_ctr_add(ctx->state, 1, ctx->ctr64);
+        ctx->ks_used = in_block;
+    }
+}
+
+void chacha20_update(chacha20_ctx *ctx, uint8_t *out, const uint8_t *in, size_t len) {
+    // Drain keystream carried over from the previous call
+    while (len > 0 && ctx->ks_used < sizeof(ctx->ks)) {
+        *out++ = *in++ ^ ctx->ks[ctx->ks_used++];
+        len--;
+    }
+    // Whole blocks go straight through the SIMD kernels
+    size_t bulk = len & ~(size_t)63;
+    if (bulk > 0) {
+        chacha_blocks_best(out, in, bulk, ctx->state, ctx->ctr64, 20);
+        out += bulk;
+        in  += bulk;
+        len -= bulk;
+    }
+    // Partial last block: keep the rest of its keystream for later
+    if (len > 0) {
+        chacha20_block(ctx->ks, ctx->state);
+        chacha20_ctr_add(ctx->state, 1, ctx->ctr64);
+        for (size_t i = 0; i < len; i++) {
+            out[i] = in[i] ^ ctx->ks[i];
+        }
+        ctx->ks_used = len;
+    }
+}
+
+//chacha20_updatev(ctx, in, n_in, out, n_out) / chacha20_xorv(...):
+//  Scatter-gather form of chacha20_update for messages held as buffer
+//  chains. Both lists are walked together and each stretch where the
+//  current in and out segments overlap goes straight to chacha20_update,
+//  so whole blocks run through the SIMD kernels in place and a block cut
+//  by a segment boundary is finished from ctx->ks in the next segment.
+//  The in and out segmentations may differ (out may alias in). Returns
+//  the bytes processed: the smaller of the two lists' total lengths.
+size_t chacha20_updatev(chacha20_ctx *ctx, const struct iovec *in, int n_in,
+                        const struct iovec *out, int n_out) {
+    int i = 0, o = 0;
+    size_t in_off = 0, out_off = 0, total = 0;
+    while (i < n_in && o < n_out) {
+        size_t in_left = in[i].iov_len - in_off;
+        size_t out_left = out[o].iov_len - out_off;
+        size_t n = in_left < out_left ? in_left : out_left;
+        if (n > 0) {
+            chacha20_update(ctx, (uint8_t *)out[o].iov_base + out_off,
+                            (const uint8_t *)in[i].iov_base + in_off, n);
+            total += n;
+        }
+        in_off += n;
+        out_off += n;
+        if (in_off == in[i].iov_len) { i++; in_off = 0; }
+        if (out_off == out[o].iov_len) { o++; out_off = 0; }
+    }
+    return total;
+}
+
+size_t chacha20_xorv(const struct iovec *in, int n_in,
+                     const struct iovec *out, int n_out,
+                     const uint8_t key[32], const uint8_t nonce[12],
+                     uint32_t counter) {
+    chacha20_ctx ctx;
+    chacha20_init(&ctx, key, nonce, counter);
+    size_t n = chacha20_updatev(&ctx, in, n_in, out, n_out);
+    chacha20_final(&ctx);
+    return n;
+}
+
+//chacha20_keystream(out, len, key, nonce, byte_offset):
+//  Write len bytes of raw keystream starting at byte_offset of the stream
+//  with counter 0, without needing an input buffer. Lets a reader decrypt
+//  an arbitrary byte range of a large object on its own. The output is
+//  zeroed and encrypted in place so the bulk still runs through the SIMD
+//  kernels.
+void chacha20_keystream(uint8_t *out, size_t len, const uint8_t key[32],
+                        const uint8_t nonce[12], uint64_t byte_offset) {
+    chacha20_ctx ctx;
+    chacha20_init(&ctx, key, nonce, 0);
+    chacha20_seek(&ctx, byte_offset);
+    memset(out, 0, len);
+    chacha20_update(&ctx, out, out, len);
+    chacha20_final(&ctx);
+}
+
+//hchacha20(subkey, key, nonce):
+//  HChaCha20 from the XChaCha20 draft (draft-irtf-cfrg-xchacha): the state
+//  is constants | key | 16-byte nonce in words 12..15, run through the same
+//  20 rounds as chacha20_block but without the feed-forward, and words
+//  0..3 and 12..15 form the 256-bit subkey.
+void hchacha20(uint8_t subkey[32], const uint8_t key[32], const uint8_t nonce[16]) {
+    uint32_t x0 = 0x61707865, x1 = 0x3320646e, x2 = 0x79622d32, x3 = 0x6b206574;
+    uint32_t x4 = load32_le(key + 0),   x5 = load32_le(key + 4);
+    uint32_t x6 = load32_le(key + 8),   x7 = load32_le(key + 12);
+    uint32_t x8 = load32_le(key + 16),  x9 = load32_le(key + 20);
+    uint32_t x10 = load32_le(key + 24), x11 = load32_le(key + 28);
+    uint32_t x12 = load32_le(nonce + 0), x13 = load32_le(nonce + 4);
+    uint32_t x14 = load32_le(nonce + 8), x15 = load32_le(nonce + 12);
+
+    CHACHA_DOUBLEROUNDS(20);
+
+    store32_le(subkey +  0, x0);
+    store32_le(subkey +  4, x1);
+    store32_le(subkey +  8, x2);
+    store32_le(subkey + 12, x3);
+    store32_le(subkey + 16, x12);
+    store32_le(subkey + 20, x13);
+    store32_le(subkey + 24, x14);
+    store32_le(subkey + 28, x15);
+}
+
+//xchacha20_xor(out, in, len, key, nonce, counter):
+//  XChaCha20 with a 192-bit nonce, safe to pick at random: the first 16
+//  nonce bytes derive a subkey through HChaCha20, the last 8 (behind four
+//  zero bytes) become the 96-bit ChaCha20 nonce, and the payload then goes
+//  through chacha20_xor_best and its SIMD kernels.
+void xchacha20_xor(uint8_t *out, const uint8_t *in, size_t len,
+                   const uint8_t key[32], const uint8_t nonce[24],
+                   uint32_t counter) {
+    uint8_t subkey[32];
+    uint8_t nonce12[12] = {0};
+    hchacha20(subkey, key, nonce);
+    memcpy(nonce12 + 4, nonce + 16, 8);
+    chacha20_xor_best(out, in, len, subkey, nonce12, counter);
+    arx_wipe(subkey, sizeof(subkey));
+}
+
+void chacha20_final(chacha20_ctx *ctx) {
+    arx_wipe(ctx, sizeof(*ctx));
+}
 
-// compile with this on M1: $clang -O3 -mcpu=apple-m1 -std=c11 -o chacha20_simd chacha20_simd.c
\ No newline at end of file
+// compile with this on M1: $clang -O3 -mcpu=apple-m1 -std=c11 -o chacha20_simd chacha20_simd.c
+// on x86_64 no -m flags are needed, the SSSE3/AVX2 kernels carry their own
+// target attributes: $gcc -O3 -std=c11 -o test_chacha chacha_main.c chacha20_simd.c
\ No newline at end of file
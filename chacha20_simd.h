@@ -0,0 +1,114 @@
+// chacha20_simd.h
+// Public interface of chacha20_simd.c: one-shot XOR kernels, the runtime
+// dispatcher and the streaming context API.
+
+#ifndef CHACHA20_SIMD_H
+#define CHACHA20_SIMD_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/uio.h>
+
+// One-shot encrypt/decrypt: key 32 bytes, nonce 12 bytes, 32-bit block counter
+void chacha20_xor_interleaved4(uint8_t *out, const uint8_t *in, size_t len,
+                               const uint8_t key[32], const uint8_t nonce[12],
+                               uint32_t counter);
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+void chacha20_xor_neon4(uint8_t *out, const uint8_t *in, size_t len,
+                        const uint8_t key[32], const uint8_t nonce[12],
+                        uint32_t counter);
+void chacha20_xor_neon8(uint8_t *out, const uint8_t *in, size_t len,
+                        const uint8_t key[32], const uint8_t nonce[12],
+                        uint32_t counter);
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+// Only call these directly on CPUs that support the instruction set
+void chacha20_xor_ssse3(uint8_t *out, const uint8_t *in, size_t len,
+                        const uint8_t key[32], const uint8_t nonce[12],
+                        uint32_t counter);
+void chacha20_xor_avx2(uint8_t *out, const uint8_t *in, size_t len,
+                       const uint8_t key[32], const uint8_t nonce[12],
+                       uint32_t counter);
+void chacha20_xor_avx512(uint8_t *out, const uint8_t *in, size_t len,
+                         const uint8_t key[32], const uint8_t nonce[12],
+                         uint32_t counter);
+#endif
+void chacha20_xor_best(uint8_t *out, const uint8_t *in, size_t len,
+                       const uint8_t key[32], const uint8_t nonce[12],
+                       uint32_t counter);
+
+// Measure where each SIMD path starts paying off on this machine and make
+// chacha20_xor_best dispatch on message length accordingly. With a
+// cache_path the thresholds are loaded from / saved to that file. Returns
+// 0 (from cache), 1 (calibrated) or -1 (calibrated, cache not written).
+int chacha20_autotune(const char *cache_path);
+// Name of the kernel chacha20_xor_best picks for len bytes
+const char *chacha20_path_for_len(size_t len);
+
+// Reduced-round ChaCha8 / ChaCha12, same layout as chacha20_xor_best. Not
+// for protecting data; use for fast non-adversarial randomness.
+void chacha8_xor(uint8_t *out, const uint8_t *in, size_t len,
+                 const uint8_t key[32], const uint8_t nonce[12],
+                 uint32_t counter);
+void chacha12_xor(uint8_t *out, const uint8_t *in, size_t len,
+                  const uint8_t key[32], const uint8_t nonce[12],
+                  uint32_t counter);
+
+// One message of a batch: its own buffers, key, nonce and counter
+typedef struct {
+    uint8_t       *out;
+    const uint8_t *in;
+    size_t         len;
+    const uint8_t *key;    // 32 bytes
+    const uint8_t *nonce;  // 12 bytes
+    uint32_t       counter;
+} chacha20_msg;
+
+// Encrypt/decrypt n independent messages, one message per SIMD lane, for
+// traffic made of many short packets
+void chacha20_xor_batch(const chacha20_msg *msgs, size_t n);
+
+// Original DJB variant: 64-bit block counter (words 12-13), 64-bit nonce
+void chacha20_djb_xor(uint8_t *out, const uint8_t *in, size_t len,
+                      const uint8_t key[32], const uint8_t nonce[8],
+                      uint64_t counter);
+
+// Streaming context: state is expanded once by chacha20_init, keystream
+// bytes left over from a partial block are kept for the next update.
+typedef struct {
+    uint32_t state[16];  // expanded state, state[12] = next block counter
+    uint8_t  ks[64];     // keystream of the last partial block
+    size_t   ks_used;    // bytes of ks already consumed (64 = none left)
+    uint64_t counter0;   // counter passed to the init call, base for seeks
+    int      ctr64;      // 1 for the 64-bit counter (DJB) layout
+} chacha20_ctx;
+
+void chacha20_init(chacha20_ctx *ctx, const uint8_t key[32],
+                   const uint8_t nonce[12], uint32_t counter);
+void chacha20_update(chacha20_ctx *ctx, uint8_t *out, const uint8_t *in, size_t len);
+void chacha20_djb_init(chacha20_ctx *ctx, const uint8_t key[32],
+                       const uint8_t nonce[8], uint64_t counter);
+void chacha20_seek(chacha20_ctx *ctx, uint64_t byte_offset);
+void chacha20_final(chacha20_ctx *ctx);
+
+// Scatter-gather: encrypt the bytes of the in chain into the out chain
+// (segmented independently), carrying keystream across segment boundaries.
+// Return the number of bytes processed.
+size_t chacha20_updatev(chacha20_ctx *ctx, const struct iovec *in, int n_in,
+                        const struct iovec *out, int n_out);
+size_t chacha20_xorv(const struct iovec *in, int n_in,
+                     const struct iovec *out, int n_out,
+                     const uint8_t key[32], const uint8_t nonce[12],
+                     uint32_t counter);
+
+// Raw keystream of the counter-0 stream starting at any byte offset
+void chacha20_keystream(uint8_t *out, size_t len, const uint8_t key[32],
+                        const uint8_t nonce[12], uint64_t byte_offset);
+
+// XChaCha20: HChaCha20 subkey derivation and 192-bit nonce encryption
+void hchacha20(uint8_t subkey[32], const uint8_t key[32], const uint8_t nonce[16]);
+void xchacha20_xor(uint8_t *out, const uint8_t *in, size_t len,
+                   const uint8_t key[32], const uint8_t nonce[24],
+                   uint32_t counter);
+
+#endif
@@ -0,0 +1,102 @@
+// chacha20poly1305.c
+// ChaCha20-Poly1305 AEAD as in RFC 8439 section 2.8, single pass.
+//
+//   one-time Poly1305 key = first 32 bytes of ChaCha20 block 0
+//   ciphertext           = ChaCha20 starting at counter 1
+//   tag = Poly1305(aad | pad16 | ciphertext | pad16 | le64(aad_len) | le64(len))
+//
+// The message is walked in CHACHA20POLY1305_CHUNK sized pieces: each piece
+// is encrypted with the streaming ChaCha20 context and then fed to Poly1305
+// while it is still in L1, so the data is only read from memory once.
+// Open authenticates each ciphertext piece before decrypting it, which
+// keeps in-place decryption (pt == ct) correct.
+//
+// Build: gcc -O3 -std=c11 -c chacha20poly1305.c chacha20_simd.c poly1305.c
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "arx_simd.h"
+#include "chacha20_simd.h"
+#include "poly1305.h"
+#include "chacha20poly1305.h"
+
+// Multiple of 64 so only the final piece can end mid-block
+#ifndef CHACHA20POLY1305_CHUNK
+#define CHACHA20POLY1305_CHUNK 4096
+#endif
+
+static const uint8_t zeros16[16];
+
+// Set up both halves: block 0 of the stream becomes the Poly1305 key, and
+// the ChaCha20 context is left at counter 1 for the payload.
+static void aead_init(chacha20_ctx *cc, poly1305_ctx *pc,
+                      const uint8_t *aad, size_t aad_len,
+                      const uint8_t key[32], const uint8_t nonce[12]) {
+    uint8_t otk[64] = {0};
+    chacha20_init(cc, key, nonce, 0);
+    chacha20_update(cc, otk, otk, sizeof(otk));
+    poly1305_init(pc, otk);
+    arx_wipe(otk, sizeof(otk));
+
+    poly1305_update(pc, aad, aad_len);
+    poly1305_update(pc, zeros16, (16 - aad_len % 16) % 16);
+}
+
+// Ciphertext padding and the two length words
+static void aead_finish(chacha20_ctx *cc, poly1305_ctx *pc,
+                        size_t aad_len, size_t len, uint8_t tag[16]) {
+    uint8_t lens[16];
+    poly1305_update(pc, zeros16, (16 - len % 16) % 16);
+    for (int i = 0; i < 8; i++) {
+        lens[i]     = (uint8_t)((uint64_t)aad_len >> (8 * i));
+        lens[8 + i] = (uint8_t)((uint64_t)len >> (8 * i));
+    }
+    poly1305_update(pc, lens, sizeof(lens));
+    poly1305_finish(pc, tag);
+    chacha20_final(cc);
+}
+
+void chacha20poly1305_seal(uint8_t *ct, uint8_t tag[16],
+                           const uint8_t *pt, size_t len,
+                           const uint8_t *aad, size_t aad_len,
+                           const uint8_t key[32], const uint8_t nonce[12]) {
+    chacha20_ctx cc;
+    poly1305_ctx pc;
+    aead_init(&cc, &pc, aad, aad_len, key, nonce);
+    for (size_t off = 0; off < len; off += CHACHA20POLY1305_CHUNK) {
+        size_t n = len - off < CHACHA20POLY1305_CHUNK ? len - off : CHACHA20POLY1305_CHUNK;
+        chacha20_update(&cc, ct + off, pt + off, n);
+        poly1305_update(&pc, ct + off, n);
+    }
+    aead_finish(&cc, &pc, aad_len, len, tag);
+}
+
+int chacha20poly1305_open(uint8_t *pt,
+                          const uint8_t *ct, size_t len,
+                          const uint8_t tag[16],
+                          const uint8_t *aad, size_t aad_len,
+                          const uint8_t key[32], const uint8_t nonce[12]) {
+    chacha20_ctx cc;
+    poly1305_ctx pc;
+    uint8_t calc[16];
+    aead_init(&cc, &pc, aad, aad_len, key, nonce);
+    for (size_t off = 0; off < len; off += CHACHA20POLY1305_CHUNK) {
+        size_t n = len - off < CHACHA20POLY1305_CHUNK ? len - off : CHACHA20POLY1305_CHUNK;
+        poly1305_update(&pc, ct + off, n);
+        chacha20_update(&cc, pt + off, ct + off, n);
+    }
+    aead_finish(&cc, &pc, aad_len, len, calc);
+
+    // Constant-time compare: no early exit on the first differing byte
+    uint8_t diff = 0;
+    for (int i = 0; i < 16; i++) {
+        diff |= (uint8_t)(calc[i] ^ tag[i]);
+    }
+    if (diff != 0) {
+        memset(pt, 0, len);
+        return -1;
+    }
+    return 0;
+}
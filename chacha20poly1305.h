@@ -0,0 +1,24 @@
+// chacha20poly1305.h
+// ChaCha20-Poly1305 AEAD (RFC 8439 section 2.8), see chacha20poly1305.c.
+
+#ifndef CHACHA20POLY1305_H
+#define CHACHA20POLY1305_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Encrypt len bytes of pt into ct (may alias) and write the 16-byte tag
+void chacha20poly1305_seal(uint8_t *ct, uint8_t tag[16],
+                           const uint8_t *pt, size_t len,
+                           const uint8_t *aad, size_t aad_len,
+                           const uint8_t key[32], const uint8_t nonce[12]);
+
+// Verify tag and decrypt ct into pt (may alias). Returns 0 on success,
+// -1 if the tag does not match; pt is zeroed in that case.
+int chacha20poly1305_open(uint8_t *pt,
+                          const uint8_t *ct, size_t len,
+                          const uint8_t tag[16],
+                          const uint8_t *aad, size_t aad_len,
+                          const uint8_t key[32], const uint8_t nonce[12]);
+
+#endif
@@ -0,0 +1,712 @@
+// chacha_bench.c
+// Throughput benchmark for the ChaCha20 kernels: the reference chacha20_xor
+// (chacha20.c), the interleaved scalar path, every SIMD path available on
+// this CPU and the chacha20_xor_best dispatcher. Also the known-answer
+// gate for Poly1305, the ChaCha20-Poly1305 AEAD, the XSalsa20-Poly1305
+// secretbox and scrypt.
+//
+// Build:
+//   x86_64:        gcc -O3 -std=gnu11 -pthread -o chacha_bench chacha_bench.c chacha20_simd.c chacha20.c poly1305.c chacha20poly1305.c salsa.c xsalsa20poly1305.c scrypt.c
+//   Apple Silicon: clang -O3 -mcpu=apple-m1 -std=gnu11 -pthread -o chacha_bench chacha_bench.c chacha20_simd.c chacha20.c poly1305.c chacha20poly1305.c salsa.c xsalsa20poly1305.c scrypt.c
+//
+// Examples:
+//   ./chacha_bench
+//   ./chacha_bench --max 64M --reps 51
+//   ./chacha_bench --kernel avx2 --kernel best --min 1K --max 1M --hot-only
+//   ./chacha_bench --autotune ~/.chacha20-tune --kernel best --max 64K
+//
+// Notes:
+// - Before timing, every kernel is checked against the RFC 8439 §2.4.2 and
+//   A.2 #1 known answers and against chacha20_xor on lengths that reach
+//   its full-width loops. A kernel that fails is reported and skipped.
+//   Poly1305 is checked against §2.5.2 and A.3, one-shot (AVX2 where
+//   available) against 15-byte updates, and the AEAD against §2.8.2 and
+//   A.5, the secretbox against libsodium crypto_secretbox_easy output and
+//   scrypt against RFC 7914 §12; --check-only exits nonzero if any of it
+//   fails.
+// - Sizes go from --min to --max in steps of 4x (default 16 B .. 1 GiB),
+//   encrypting in place. Each size runs hot (buffer already in cache,
+//   several calls per sample for short messages) and cold (a --evict sized
+//   buffer is swept before every single call), each both 64-byte aligned
+//   and at offset +1.
+// - "cycles" are TSC ticks (__rdtsc) on x86; elsewhere nanoseconds times
+//   --ghz (default 3.2, an M1 performance core).
+// - min/med/p99 are over the samples of one configuration; GB/s is given
+//   for the same three samples, so the p99 column is the slow tail.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "chacha20_simd.h"
+#include "poly1305.h"
+#include "chacha20poly1305.h"
+#include "xsalsa20poly1305.h"
+#include "scrypt.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+  #include <x86intrin.h>
+  #define HAVE_TSC 1
+#else
+  #define HAVE_TSC 0
+#endif
+
+// chacha20.c has no header of its own
+void chacha20_xor(uint8_t *out, const uint8_t *in, size_t len,
+                  const uint8_t key[32], const uint8_t nonce[12], uint32_t counter);
+
+// ===================== Kernels under test =====================
+
+typedef void (*xor_fn)(uint8_t *out, const uint8_t *in, size_t len,
+                       const uint8_t key[32], const uint8_t nonce[12],
+                       uint32_t counter);
+
+typedef struct {
+    const char *name;
+    xor_fn fn;
+    const char *cpu;  // __builtin_cpu_supports feature, NULL if always usable
+} kernel;
+
+static const kernel KERNELS[] = {
+    { "ref",          chacha20_xor,              NULL },
+    { "interleaved4", chacha20_xor_interleaved4, NULL },
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    { "neon4",        chacha20_xor_neon4,        NULL },
+    { "neon8",        chacha20_xor_neon8,        NULL },
+#endif
+#if HAVE_TSC
+    { "ssse3",        chacha20_xor_ssse3,        "ssse3" },
+    { "avx2",         chacha20_xor_avx2,         "avx2" },
+    { "avx512",       chacha20_xor_avx512,       "avx512f" },
+#endif
+    { "best",         chacha20_xor_best,         NULL },
+};
+static const size_t N_KERNELS = sizeof(KERNELS) / sizeof(KERNELS[0]);
+
+static int kernel_usable(const kernel *k) {
+#if HAVE_TSC
+    if (k->cpu != NULL) {
+        __builtin_cpu_init();
+        if (!strcmp(k->cpu, "ssse3"))   return __builtin_cpu_supports("ssse3");
+        if (!strcmp(k->cpu, "avx2"))    return __builtin_cpu_supports("avx2");
+        if (!strcmp(k->cpu, "avx512f")) return __builtin_cpu_supports("avx512f");
+        return 0;
+    }
+#endif
+    return 1;
+}
+
+// ===================== RFC 8439 known answers =====================
+
+// §2.4.2: key 00..1f, nonce 00 00 00 00 00 00 00 4a 00 00 00 00, counter 1
+static const char SUNSCREEN[] =
+    "Ladies and Gentlemen of the class of '99: If I could offer you only one "
+    "tip for the future, sunscreen would be it.";
+static const uint8_t SUNSCREEN_CT[114] = {
+    0x6e,0x2e,0x35,0x9a,0x25,0x68,0xf9,0x80,0x41,0xba,0x07,0x28,0xdd,0x0d,0x69,0x81,
+    0xe9,0x7e,0x7a,0xec,0x1d,0x43,0x60,0xc2,0x0a,0x27,0xaf,0xcc,0xfd,0x9f,0xae,0x0b,
+    0xf9,0x1b,0x65,0xc5,0x52,0x47,0x33,0xab,0x8f,0x59,0x3d,0xab,0xcd,0x62,0xb3,0x57,
+    0x16,0x39,0xd6,0x24,0xe6,0x51,0x52,0xab,0x8f,0x53,0x0c,0x35,0x9f,0x08,0x61,0xd8,
+    0x07,0xca,0x0d,0xbf,0x50,0x0d,0x6a,0x61,0x56,0xa3,0x8e,0x08,0x8a,0x22,0xb6,0x5e,
+    0x52,0xbc,0x51,0x4d,0x16,0xcc,0xf8,0x06,0x81,0x8c,0xe9,0x1a,0xb7,0x79,0x37,0x36,
+    0x5a,0xf9,0x0b,0xbf,0x74,0xa3,0x5b,0xe6,0xb4,0x0b,0x8e,0xed,0xf2,0x78,0x5e,0x42,
+    0x87,0x4d,
+};
+
+// A.2 test vector #1: all-zero key, nonce and plaintext, counter 0
+static const uint8_t ZERO_KS[64] = {
+    0x76,0xb8,0xe0,0xad,0xa0,0xf1,0x3d,0x90,0x40,0x5d,0x6a,0xe5,0x53,0x86,0xbd,0x28,
+    0xbd,0xd2,0x19,0xb8,0xa0,0x8d,0xed,0x1a,0xa8,0x36,0xef,0xcc,0x8b,0x77,0x0d,0xc7,
+    0xda,0x41,0x59,0x7c,0x51,0x57,0x48,0x8d,0x77,0x24,0xe0,0x3f,0xb8,0xd8,0x4a,0x37,
+    0x6a,0x43,0xb8,0xf4,0x15,0x18,0xa1,0x1c,0xc3,0x87,0xb6,0x69,0xb2,0xee,0x65,0x86,
+};
+
+// Returns 0 if the kernel reproduces the RFC vectors and matches the
+// reference on lengths up to 4 KiB + 63 (every full-width loop and tail)
+static int check_kernel(const kernel *k) {
+    uint8_t key[32], nonce[12] = {0, 0, 0, 0, 0, 0, 0, 0x4a, 0, 0, 0, 0};
+    uint8_t out[114], zero[64] = {0}, ks[64];
+    for (int i = 0; i < 32; i++) key[i] = (uint8_t)i;
+
+    k->fn(out, (const uint8_t *)SUNSCREEN, sizeof(SUNSCREEN_CT), key, nonce, 1);
+    if (memcmp(out, SUNSCREEN_CT, sizeof(SUNSCREEN_CT)) != 0) return -1;
+    memset(key, 0, sizeof(key));
+    memset(nonce, 0, sizeof(nonce));
+    k->fn(ks, zero, sizeof(zero), key, nonce, 0);
+    if (memcmp(ks, ZERO_KS, sizeof(ZERO_KS)) != 0) return -1;
+
+    enum { MAXLEN = 4096 + 63 };
+    uint8_t *in = malloc(MAXLEN), *a = malloc(MAXLEN), *b = malloc(MAXLEN);
+    if (!in || !a || !b) { fprintf(stderr, "OOM\n"); exit(1); }
+    for (size_t i = 0; i < MAXLEN; i++) in[i] = (uint8_t)(i * 131 + 7);
+    for (int i = 0; i < 32; i++) key[i] = (uint8_t)(0xa5 ^ i);
+    int rc = 0;
+    for (size_t len = 0; len <= MAXLEN && rc == 0; len += (len < 256 ? 1 : 61)) {
+        // counter close to 2^32 so the 32-bit wrap falls inside the message
+        chacha20_xor(a, in, len, key, nonce, 0xfffffff0u);
+        k->fn(b, in, len, key, nonce, 0xfffffff0u);
+        if (memcmp(a, b, len) != 0) rc = -1;
+    }
+    free(in); free(a); free(b);
+    return rc;
+}
+
+// ===================== Poly1305 / AEAD known answers =====================
+
+// §2.8.2 and A.3 #2/#3: the IETF boilerplate, 375 bytes (23 blocks, so the
+// AVX2 Poly1305 path runs on it)
+static const char IETF_TEXT[] =
+    "Any submission to the IETF intended by the Contributor for publication as all or "
+    "part of an IETF Internet-Draft or RFC and any statement made within the context "
+    "of an IETF activity is considered an \"IETF Contribution\". Such statements "
+    "include oral statements in IETF sessions, as well as written and electronic "
+    "communications made at any time or place, which are addressed to";
+
+// A.3 #4
+static const char JABBERWOCKY[] =
+    "'Twas brillig, and the slithy toves\nDid gyre and gimble in the wabe:\n"
+    "All mimsy were the borogoves,\nAnd the mome raths outgrabe.";
+
+// A.3 #1
+static const uint8_t ZERO64[64];
+
+// A.3 #5..#11: messages that drive h through the 2^130 - 5 carries
+static const uint8_t A3_5_MSG[16] = {
+    0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,
+};
+static const uint8_t A3_6_MSG[16] = {
+    0x02,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+};
+static const uint8_t A3_7_MSG[48] = {
+    0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,
+    0xf0,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,
+    0x11,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+};
+static const uint8_t A3_8_MSG[48] = {
+    0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,
+    0xfb,0xfe,0xfe,0xfe,0xfe,0xfe,0xfe,0xfe,0xfe,0xfe,0xfe,0xfe,0xfe,0xfe,0xfe,0xfe,
+    0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,
+};
+static const uint8_t A3_9_MSG[16] = {
+    0xfd,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,
+};
+static const uint8_t A3_10_MSG[64] = {
+    0xe3,0x35,0x94,0xd7,0x50,0x5e,0x43,0xb9,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x33,0x94,0xd7,0x50,0x5e,0x43,0x79,0xcd,0x01,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+    0x01,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+};
+
+typedef struct {
+    uint8_t key[32];
+    const uint8_t *msg;
+    size_t len;
+    uint8_t tag[16];
+} mac_vector;
+
+// §2.5.2 and A.3 #1..#11
+static const mac_vector MAC_VECTORS[] = {
+    // §2.5.2
+    { {
+        0x85,0xd6,0xbe,0x78,0x57,0x55,0x6d,0x33,0x7f,0x44,0x52,0xfe,0x42,0xd5,0x06,0xa8,
+        0x01,0x03,0x80,0x8a,0xfb,0x0d,0xb2,0xfd,0x4a,0xbf,0xf6,0xaf,0x41,0x49,0xf5,0x1b,
+      },
+      (const uint8_t *)"Cryptographic Forum Research Group", 34,
+      {0xa8,0x06,0x1d,0xc1,0x30,0x51,0x36,0xc6,0xc2,0x2b,0x8b,0xaf,0x0c,0x01,0x27,0xa9} },
+    // A.3 #1
+    { {0x00},
+      ZERO64, sizeof(ZERO64), {0x00} },
+    // #2
+    { {
+        0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+        0x36,0xe5,0xf6,0xb5,0xc5,0xe0,0x60,0x70,0xf0,0xef,0xca,0x96,0x22,0x7a,0x86,0x3e,
+      },
+      (const uint8_t *)IETF_TEXT, 375,
+      {0x36,0xe5,0xf6,0xb5,0xc5,0xe0,0x60,0x70,0xf0,0xef,0xca,0x96,0x22,0x7a,0x86,0x3e} },
+    // #3
+    { {0x36,0xe5,0xf6,0xb5,0xc5,0xe0,0x60,0x70,0xf0,0xef,0xca,0x96,0x22,0x7a,0x86,0x3e},
+      (const uint8_t *)IETF_TEXT, 375,
+      {0xf3,0x47,0x7e,0x7c,0xd9,0x54,0x17,0xaf,0x89,0xa6,0xb8,0x79,0x4c,0x31,0x0c,0xf0} },
+    // #4
+    { {
+        0x1c,0x92,0x40,0xa5,0xeb,0x55,0xd3,0x8a,0xf3,0x33,0x88,0x86,0x04,0xf6,0xb5,0xf0,
+        0x47,0x39,0x17,0xc1,0x40,0x2b,0x80,0x09,0x9d,0xca,0x5c,0xbc,0x20,0x70,0x75,0xc0,
+      },
+      (const uint8_t *)JABBERWOCKY, 127,
+      {0x45,0x41,0x66,0x9a,0x7e,0xaa,0xee,0x61,0xe7,0x08,0xdc,0x7c,0xbc,0xc5,0xeb,0x62} },
+    // #5
+    { {0x02},
+      A3_5_MSG, sizeof(A3_5_MSG), {0x03} },
+    // #6
+    { {
+        0x02,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
+        0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,
+      },
+      A3_6_MSG, sizeof(A3_6_MSG), {0x03} },
+    // #7
+    { {0x01},
+      A3_7_MSG, sizeof(A3_7_MSG), {0x05} },
+    // #8
+    { {0x01},
+      A3_8_MSG, sizeof(A3_8_MSG), {0x00} },
+    // #9
+    { {0x02},
+      A3_9_MSG, sizeof(A3_9_MSG),
+      {0xfa,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff} },
+    // #10
+    { {0x01,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x04},
+      A3_10_MSG, sizeof(A3_10_MSG), {0x14,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x55} },
+    // #11
+    { {0x01,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x04},
+      A3_10_MSG, 48, {0x13} },
+};
+
+// §2.8.2: SUNSCREEN under key 80..9f, nonce 07 00 00 00 40..47
+static const uint8_t AEAD_NONCE[12] = {0x07,0x00,0x00,0x00,0x40,0x41,0x42,0x43,0x44,0x45,0x46,0x47};
+static const uint8_t AEAD_AAD[12] = {0x50,0x51,0x52,0x53,0xc0,0xc1,0xc2,0xc3,0xc4,0xc5,0xc6,0xc7};
+static const uint8_t AEAD_CT[114] = {
+    0xd3,0x1a,0x8d,0x34,0x64,0x8e,0x60,0xdb,0x7b,0x86,0xaf,0xbc,0x53,0xef,0x7e,0xc2,
+    0xa4,0xad,0xed,0x51,0x29,0x6e,0x08,0xfe,0xa9,0xe2,0xb5,0xa7,0x36,0xee,0x62,0xd6,
+    0x3d,0xbe,0xa4,0x5e,0x8c,0xa9,0x67,0x12,0x82,0xfa,0xfb,0x69,0xda,0x92,0x72,0x8b,
+    0x1a,0x71,0xde,0x0a,0x9e,0x06,0x0b,0x29,0x05,0xd6,0xa5,0xb6,0x7e,0xcd,0x3b,0x36,
+    0x92,0xdd,0xbd,0x7f,0x2d,0x77,0x8b,0x8c,0x98,0x03,0xae,0xe3,0x28,0x09,0x1b,0x58,
+    0xfa,0xb3,0x24,0xe4,0xfa,0xd6,0x75,0x94,0x55,0x85,0x80,0x8b,0x48,0x31,0xd7,0xbc,
+    0x3f,0xf4,0xde,0xf0,0x8e,0x4b,0x7a,0x9d,0xe5,0x76,0xd2,0x65,0x86,0xce,0xc6,0x4b,
+    0x61,0x16,
+};
+static const uint8_t AEAD_TAG[16] = {
+    0x1a,0xe1,0x0b,0x59,0x4f,0x09,0xe2,0x6a,0x7e,0x90,0x2e,0xcb,0xd0,0x60,0x06,0x91,
+};
+
+// A.5: decryption of an Internet-Draft notice, 265 bytes
+static const char A5_PT[] =
+    "Internet-Drafts are draft documents valid for a maximum of six months and may be "
+    "updated, replaced, or obsoleted by other documents at any time. It is inappropriate "
+    "to use Internet-Drafts as reference material or to cite them other than as "
+    "/\xe2\x80\x9cwork in progress./\xe2\x80\x9d";
+static const uint8_t A5_KEY[32] = {
+    0x1c,0x92,0x40,0xa5,0xeb,0x55,0xd3,0x8a,0xf3,0x33,0x88,0x86,0x04,0xf6,0xb5,0xf0,
+    0x47,0x39,0x17,0xc1,0x40,0x2b,0x80,0x09,0x9d,0xca,0x5c,0xbc,0x20,0x70,0x75,0xc0,
+};
+static const uint8_t A5_NONCE[12] = {
+    0x00,0x00,0x00,0x00,0x01,0x02,0x03,0x04,0x05,0x06,0x07,0x08,
+};
+static const uint8_t A5_AAD[12] = {
+    0xf3,0x33,0x88,0x86,0x00,0x00,0x00,0x00,0x00,0x00,0x4e,0x91,
+};
+static const uint8_t A5_CT[265] = {
+    0x64,0xa0,0x86,0x15,0x75,0x86,0x1a,0xf4,0x60,0xf0,0x62,0xc7,0x9b,0xe6,0x43,0xbd,
+    0x5e,0x80,0x5c,0xfd,0x34,0x5c,0xf3,0x89,0xf1,0x08,0x67,0x0a,0xc7,0x6c,0x8c,0xb2,
+    0x4c,0x6c,0xfc,0x18,0x75,0x5d,0x43,0xee,0xa0,0x9e,0xe9,0x4e,0x38,0x2d,0x26,0xb0,
+    0xbd,0xb7,0xb7,0x3c,0x32,0x1b,0x01,0x00,0xd4,0xf0,0x3b,0x7f,0x35,0x58,0x94,0xcf,
+    0x33,0x2f,0x83,0x0e,0x71,0x0b,0x97,0xce,0x98,0xc8,0xa8,0x4a,0xbd,0x0b,0x94,0x81,
+    0x14,0xad,0x17,0x6e,0x00,0x8d,0x33,0xbd,0x60,0xf9,0x82,0xb1,0xff,0x37,0xc8,0x55,
+    0x97,0x97,0xa0,0x6e,0xf4,0xf0,0xef,0x61,0xc1,0x86,0x32,0x4e,0x2b,0x35,0x06,0x38,
+    0x36,0x06,0x90,0x7b,0x6a,0x7c,0x02,0xb0,0xf9,0xf6,0x15,0x7b,0x53,0xc8,0x67,0xe4,
+    0xb9,0x16,0x6c,0x76,0x7b,0x80,0x4d,0x46,0xa5,0x9b,0x52,0x16,0xcd,0xe7,0xa4,0xe9,
+    0x90,0x40,0xc5,0xa4,0x04,0x33,0x22,0x5e,0xe2,0x82,0xa1,0xb0,0xa0,0x6c,0x52,0x3e,
+    0xaf,0x45,0x34,0xd7,0xf8,0x3f,0xa1,0x15,0x5b,0x00,0x47,0x71,0x8c,0xbc,0x54,0x6a,
+    0x0d,0x07,0x2b,0x04,0xb3,0x56,0x4e,0xea,0x1b,0x42,0x22,0x73,0xf5,0x48,0x27,0x1a,
+    0x0b,0xb2,0x31,0x60,0x53,0xfa,0x76,0x99,0x19,0x55,0xeb,0xd6,0x31,0x59,0x43,0x4e,
+    0xce,0xbb,0x4e,0x46,0x6d,0xae,0x5a,0x10,0x73,0xa6,0x72,0x76,0x27,0x09,0x7a,0x10,
+    0x49,0xe6,0x17,0xd9,0x1d,0x36,0x10,0x94,0xfa,0x68,0xf0,0xff,0x77,0x98,0x71,0x30,
+    0x30,0x5b,0xea,0xba,0x2e,0xda,0x04,0xdf,0x99,0x7b,0x71,0x4d,0x6c,0x6f,0x2c,0x29,
+    0xa6,0xad,0x5c,0xb4,0x02,0x2b,0x02,0x70,0x9b,
+};
+static const uint8_t A5_TAG[16] = {
+    0xee,0xad,0x9d,0x67,0x89,0x0c,0xbb,0x22,0x39,0x23,0x36,0xfe,0xa1,0x85,0x1f,0x38,
+};
+
+// Returns 0 if Poly1305 reproduces §2.5.2 and A.3, and if one-shot MACs
+// (which take the AVX2 path from 16 blocks on) match the same message fed
+// 15 bytes per update (scalar blocks only) on lengths up to 2 KiB + 15,
+// for random-looking and all-0xff messages and keys
+static int check_poly1305(void) {
+    uint8_t mac[16], ref[16], key[32];
+    for (size_t i = 0; i < sizeof(MAC_VECTORS) / sizeof(MAC_VECTORS[0]); i++) {
+        const mac_vector *v = &MAC_VECTORS[i];
+        poly1305_auth(mac, v->msg, v->len, v->key);
+        if (memcmp(mac, v->tag, 16) != 0) return -1;
+    }
+
+    enum { MAXLEN = 2048 + 15 };
+    uint8_t *m = malloc(MAXLEN);
+    if (!m) { fprintf(stderr, "OOM\n"); exit(1); }
+    int rc = 0;
+    for (int pattern = 0; pattern < 2 && rc == 0; pattern++) {
+        for (size_t i = 0; i < MAXLEN; i++) m[i] = pattern ? 0xff : (uint8_t)(i * 131 + 7);
+        for (int i = 0; i < 32; i++) key[i] = pattern ? 0xff : (uint8_t)(0xa5 ^ i);
+        for (size_t len = 0; len <= MAXLEN && rc == 0; len += (len < 512 ? 1 : 61)) {
+            poly1305_ctx ctx;
+            poly1305_init(&ctx, key);
+            for (size_t off = 0; off < len; off += 15) {
+                poly1305_update(&ctx, m + off, len - off < 15 ? len - off : 15);
+            }
+            poly1305_finish(&ctx, ref);
+            poly1305_auth(mac, m, len, key);
+            if (memcmp(mac, ref, 16) != 0) rc = -1;
+        }
+    }
+    free(m);
+    return rc;
+}
+
+// Returns 0 if the AEAD reproduces §2.8.2, opens A.5 and rejects a
+// flipped tag bit with the plaintext zeroed
+static int check_aead(void) {
+    uint8_t key[32], ct[sizeof(AEAD_CT)], tag[16], pt[sizeof(A5_PT) - 1];
+    for (int i = 0; i < 32; i++) key[i] = (uint8_t)(0x80 + i);
+
+    chacha20poly1305_seal(ct, tag, (const uint8_t *)SUNSCREEN, sizeof(AEAD_CT),
+                          AEAD_AAD, sizeof(AEAD_AAD), key, AEAD_NONCE);
+    if (memcmp(ct, AEAD_CT, sizeof(AEAD_CT)) != 0) return -1;
+    if (memcmp(tag, AEAD_TAG, sizeof(AEAD_TAG)) != 0) return -1;
+
+    if (chacha20poly1305_open(pt, A5_CT, sizeof(A5_CT), A5_TAG,
+                              A5_AAD, sizeof(A5_AAD), A5_KEY, A5_NONCE) != 0) return -1;
+    if (memcmp(pt, A5_PT, sizeof(pt)) != 0) return -1;
+
+    memcpy(tag, A5_TAG, sizeof(tag));
+    tag[15] ^= 0x80;
+    if (chacha20poly1305_open(pt, A5_CT, sizeof(A5_CT), tag,
+                              A5_AAD, sizeof(A5_AAD), A5_KEY, A5_NONCE) != -1) return -1;
+    for (size_t i = 0; i < sizeof(pt); i++) {
+        if (pt[i] != 0) return -1;
+    }
+    return 0;
+}
+
+// ===================== Secretbox known answers =====================
+
+// libsodium crypto_secretbox_easy output (tag | ciphertext) for SUNSCREEN
+// under key 00..1f and nonce 40..57
+static const uint8_t SECRETBOX_SUNSCREEN[130] = {
+    0xe5,0x8a,0xaa,0x24,0xbc,0xcf,0x2e,0x2e,0x58,0x14,0x22,0x69,0x1c,0x64,0x39,0x9f,
+    0x06,0x76,0x31,0x10,0x5f,0x22,0x9b,0x4b,0xa8,0x3d,0x51,0x26,0x0d,0xe7,0x2e,0x9d,
+    0xab,0x5a,0x23,0x3a,0x4d,0x2c,0x39,0xe8,0x90,0xbd,0x47,0xea,0x9a,0xb5,0xe2,0x27,
+    0xa7,0x14,0x06,0x77,0xce,0x90,0xff,0x3d,0x63,0x6c,0x55,0x1f,0x11,0xbb,0x7a,0x4c,
+    0xef,0xc1,0x4f,0x09,0x87,0xe1,0xd6,0x20,0xed,0xa0,0x9b,0xcb,0x68,0x02,0xbe,0xda,
+    0xf1,0xa0,0xc1,0x85,0x34,0xa1,0x99,0x9d,0x2f,0x8d,0xe1,0x25,0xeb,0x21,0x77,0x13,
+    0x26,0x2a,0x15,0x3e,0x99,0x69,0x6d,0x43,0xed,0x02,0x97,0x61,0xa2,0x43,0xbb,0xb5,
+    0xe0,0x83,0x5a,0x2d,0xd3,0x3e,0x52,0x92,0x18,0x25,0x19,0x18,0x7c,0xa7,0x2d,0x7f,
+    0xf2,0x09,
+};
+// ... and the tag for 4196 bytes of (i * 131 + 7), which spans two
+// XSALSA20POLY1305_CHUNK pieces
+static const uint8_t SECRETBOX_LONG_TAG[16] = {
+    0xad,0x67,0x67,0xf3,0xfb,0x08,0x27,0xf7,0xda,0x8b,0xde,0xc9,0xd2,0x2f,0x7f,0x6b,
+};
+
+// Returns 0 if the secretbox reproduces the libsodium output, opens it
+// again and rejects a flipped ciphertext bit
+static int check_secretbox(void) {
+    uint8_t key[32], nonce[24], box[sizeof(SECRETBOX_SUNSCREEN)], pt[sizeof(box) - 16];
+    for (int i = 0; i < 32; i++) key[i] = (uint8_t)i;
+    for (int i = 0; i < 24; i++) nonce[i] = (uint8_t)(0x40 + i);
+
+    secretbox_easy(box, (const uint8_t *)SUNSCREEN, sizeof(pt), key, nonce);
+    if (memcmp(box, SECRETBOX_SUNSCREEN, sizeof(box)) != 0) return -1;
+    if (secretbox_open_easy(pt, box, sizeof(box), key, nonce) != 0) return -1;
+    if (memcmp(pt, SUNSCREEN, sizeof(pt)) != 0) return -1;
+    box[40] ^= 1;
+    if (secretbox_open_easy(pt, box, sizeof(box), key, nonce) != -1) return -1;
+
+    enum { LONGLEN = 4096 + 100 };
+    uint8_t *m = malloc(LONGLEN), *ct = malloc(LONGLEN), tag[16];
+    if (!m || !ct) { fprintf(stderr, "OOM\n"); exit(1); }
+    for (size_t i = 0; i < LONGLEN; i++) m[i] = (uint8_t)(i * 131 + 7);
+    xsalsa20poly1305_seal(ct, tag, m, LONGLEN, key, nonce);
+    int rc = memcmp(tag, SECRETBOX_LONG_TAG, sizeof(tag)) != 0 ? -1 : 0;
+    if (rc == 0 && xsalsa20poly1305_open(ct, ct, LONGLEN, tag, key, nonce) != 0) rc = -1;
+    if (rc == 0 && memcmp(ct, m, LONGLEN) != 0) rc = -1;
+    free(m); free(ct);
+    return rc;
+}
+
+// ===================== scrypt known answers =====================
+
+// RFC 7914 §12 #1..#3 (the 1 GiB N = 2^20 case is left out to keep the
+// check quick)
+typedef struct {
+    const char *pass, *salt;
+    uint64_t N;
+    uint32_t r, p;
+    uint8_t dk[64];
+} scrypt_vector;
+
+static const scrypt_vector SCRYPT_VECTORS[] = {
+    { "", "", 16, 1, 1, {
+    0x77,0xd6,0x57,0x62,0x38,0x65,0x7b,0x20,0x3b,0x19,0xca,0x42,0xc1,0x8a,0x04,0x97,
+    0xf1,0x6b,0x48,0x44,0xe3,0x07,0x4a,0xe8,0xdf,0xdf,0xfa,0x3f,0xed,0xe2,0x14,0x42,
+    0xfc,0xd0,0x06,0x9d,0xed,0x09,0x48,0xf8,0x32,0x6a,0x75,0x3a,0x0f,0xc8,0x1f,0x17,
+    0xe8,0xd3,0xe0,0xfb,0x2e,0x0d,0x36,0x28,0xcf,0x35,0xe2,0x0c,0x38,0xd1,0x89,0x06,
+    } },
+    { "password", "NaCl", 1024, 8, 16, {
+    0xfd,0xba,0xbe,0x1c,0x9d,0x34,0x72,0x00,0x78,0x56,0xe7,0x19,0x0d,0x01,0xe9,0xfe,
+    0x7c,0x6a,0xd7,0xcb,0xc8,0x23,0x78,0x30,0xe7,0x73,0x76,0x63,0x4b,0x37,0x31,0x62,
+    0x2e,0xaf,0x30,0xd9,0x2e,0x22,0xa3,0x88,0x6f,0xf1,0x09,0x27,0x9d,0x98,0x30,0xda,
+    0xc7,0x27,0xaf,0xb9,0x4a,0x83,0xee,0x6d,0x83,0x60,0xcb,0xdf,0xa2,0xcc,0x06,0x40,
+    } },
+    { "pleaseletmein", "SodiumChloride", 16384, 8, 1, {
+    0x70,0x23,0xbd,0xcb,0x3a,0xfd,0x73,0x48,0x46,0x1c,0x06,0xcd,0x81,0xfd,0x38,0xeb,
+    0xfd,0xa8,0xfb,0xba,0x90,0x4f,0x8e,0x3e,0xa9,0xb5,0x43,0xf6,0x54,0x5d,0xa1,0xf2,
+    0xd5,0x43,0x29,0x55,0x61,0x3f,0x0f,0xcf,0x62,0xd4,0x97,0x05,0x24,0x2a,0x9a,0xf9,
+    0xe6,0x1e,0x85,0xdc,0x0d,0x65,0x1e,0x40,0xdf,0xcf,0x01,0x7b,0x45,0x57,0x58,0x87,
+    } },
+};
+
+// Returns 0 if one-shot scrypt and a pooled context reproduce RFC 7914
+// §12, and if a context whose max_mem holds only three lanes of #2 gets
+// the same result running its p = 16 lanes a few at a time
+static int check_scrypt(void) {
+    scrypt_opts capped = { 0, 3 * 128 * 8 * (1024 + 2) };
+    scrypt_ctx *pool = scrypt_ctx_create(NULL), *grouped = scrypt_ctx_create(&capped);
+    if (!pool || !grouped) { fprintf(stderr, "OOM\n"); exit(1); }
+    int rc = 0;
+    for (size_t i = 0; i < sizeof(SCRYPT_VECTORS) / sizeof(SCRYPT_VECTORS[0]) && rc == 0; i++) {
+        const scrypt_vector *v = &SCRYPT_VECTORS[i];
+        const uint8_t *pw = (const uint8_t *)v->pass, *salt = (const uint8_t *)v->salt;
+        size_t pw_len = strlen(v->pass), salt_len = strlen(v->salt);
+        uint8_t dk[64];
+        if (scrypt(pw, pw_len, salt, salt_len, v->N, v->r, v->p, dk, sizeof(dk)) != 0 ||
+            memcmp(dk, v->dk, sizeof(dk)) != 0) rc = -1;
+        if (scrypt_ctx_hash(pool, pw, pw_len, salt, salt_len, v->N, v->r, v->p, dk, sizeof(dk)) != 0 ||
+            memcmp(dk, v->dk, sizeof(dk)) != 0) rc = -1;
+        if (v->p > 1 &&
+            (scrypt_ctx_hash(grouped, pw, pw_len, salt, salt_len, v->N, v->r, v->p, dk, sizeof(dk)) != 0 ||
+             memcmp(dk, v->dk, sizeof(dk)) != 0)) rc = -1;
+    }
+    scrypt_ctx_destroy(pool);
+    scrypt_ctx_destroy(grouped);
+    return rc;
+}
+
+// ===================== Timing =====================
+
+static double ghz = 3.2;
+
+static inline uint64_t read_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static inline uint64_t read_cycles(void) {
+#if HAVE_TSC
+    return __rdtsc();
+#else
+    return (uint64_t)((double)read_ns() * ghz);
+#endif
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile of a sorted array
+static double percentile(const double *v, size_t n, double p) {
+    size_t i = (size_t)(p * (double)n + 0.999999);
+    if (i < 1) i = 1;
+    if (i > n) i = n;
+    return v[i - 1];
+}
+
+static volatile uint8_t evict_sink;
+
+// Sweep a buffer larger than the last-level cache so the next call starts
+// with its message (and the kernel's stack) out of cache
+static void evict(uint8_t *buf, size_t n) {
+    uint8_t acc = 0;
+    for (size_t i = 0; i < n; i += 64) {
+        buf[i]++;
+        acc ^= buf[i];
+    }
+    evict_sink = acc;
+}
+
+typedef struct {
+    size_t reps;         // samples per configuration
+    uint64_t budget;     // bytes encrypted per configuration, caps reps for big sizes
+    size_t evict_bytes;
+    int hot, cold;
+} bench_opts;
+
+static void bench_one(const kernel *k, uint8_t *buf, size_t size, int cold,
+                      int misalign, uint8_t *evict_buf, const bench_opts *o,
+                      double *cpb, double *ns) {
+    static const uint8_t key[32] = {1, 2, 3}, nonce[12] = {4, 5, 6};
+    uint8_t *p = buf + misalign;
+    size_t reps = o->reps;
+    if ((uint64_t)size * reps > o->budget) reps = (size_t)(o->budget / size);
+    if (reps < 3) reps = 3;
+    // Hot: enough calls per sample that timer overhead stays below ~1%
+    size_t iters = cold ? 1 : (size < 65536 ? 65536 / size : 1);
+
+    k->fn(p, p, size, key, nonce, 1);  // warm-up, faults the pages in
+    for (size_t r = 0; r < reps; r++) {
+        if (cold) evict(evict_buf, o->evict_bytes);
+        uint64_t t0 = read_ns(), c0 = read_cycles();
+        for (size_t i = 0; i < iters; i++) {
+            k->fn(p, p, size, key, nonce, 1);
+        }
+        uint64_t c1 = read_cycles(), t1 = read_ns();
+        double bytes = (double)size * (double)iters;
+        cpb[r] = (double)(c1 - c0) / bytes;
+        ns[r] = (double)(t1 - t0) / bytes;
+    }
+    qsort(cpb, reps, sizeof(*cpb), cmp_double);
+    qsort(ns, reps, sizeof(*ns), cmp_double);
+    // ns per byte -> GB/s is 1/x; the fastest sample has the smallest ns
+    printf("%-13s %10zu  %-5s %-5s %5zu | %8.3f %8.3f %8.3f | %7.2f %7.2f %7.2f\n",
+           k->name, size, cold ? "cold" : "hot", misalign ? "+1" : "align", reps,
+           percentile(cpb, reps, 0.0), percentile(cpb, reps, 0.5), percentile(cpb, reps, 0.99),
+           1.0 / percentile(ns, reps, 0.0), 1.0 / percentile(ns, reps, 0.5),
+           1.0 / percentile(ns, reps, 0.99));
+    fflush(stdout);
+}
+
+// ===================== Driver =====================
+
+// "4096", "64K", "16M", "1G"
+static size_t parse_size(const char *s) {
+    char *end;
+    unsigned long long v = strtoull(s, &end, 10);
+    switch (*end) {
+    case 'k': case 'K': v <<= 10; break;
+    case 'm': case 'M': v <<= 20; break;
+    case 'g': case 'G': v <<= 30; break;
+    default: break;
+    }
+    return (size_t)v;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+        "Usage: %s [--min S] [--max S] [--reps N] [--kernel NAME]... [--hot-only | --cold-only]\n"
+        "          [--evict S] [--ghz F] [--check-only] [--autotune FILE]\n"
+        "  --min S / --max S  message sizes, 4x steps (default 16 .. 1G; K/M/G suffixes)\n"
+        "  --reps N           samples per configuration (default 101, at least 3, fewer for huge sizes)\n"
+        "  --kernel NAME      only run NAME (repeatable): ref interleaved4 neon4 neon8\n"
+        "                     ssse3 avx2 avx512 best\n"
+        "  --hot-only         skip the cold-cache runs (and --cold-only the hot ones)\n"
+        "  --evict S          eviction sweep for cold runs (default 64M)\n"
+        "  --ghz F            clock used to turn ns into cycles without a TSC (default 3.2)\n"
+        "  --check-only       run the known-answer checks and exit\n"
+        "  --autotune FILE    calibrate chacha20_xor_best first (cache in FILE, - for none)\n",
+        prog);
+}
+
+int main(int argc, char **argv) {
+    size_t min_size = 16, max_size = (size_t)1 << 30;
+    bench_opts o = { 101, (uint64_t)4 << 30, (size_t)64 << 20, 1, 1 };
+    const char *only[16];
+    int n_only = 0, check_only = 0;
+    const char *tune = NULL;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--help")) { usage(argv[0]); return 0; }
+        else if (!strcmp(argv[i], "--min") && i+1 < argc) { min_size = parse_size(argv[++i]); }
+        else if (!strcmp(argv[i], "--max") && i+1 < argc) { max_size = parse_size(argv[++i]); }
+        else if (!strcmp(argv[i], "--reps") && i+1 < argc) { o.reps = (size_t)atoi(argv[++i]); }
+        else if (!strcmp(argv[i], "--kernel") && i+1 < argc && n_only < 16) { only[n_only++] = argv[++i]; }
+        else if (!strcmp(argv[i], "--hot-only")) { o.cold = 0; }
+        else if (!strcmp(argv[i], "--cold-only")) { o.hot = 0; }
+        else if (!strcmp(argv[i], "--evict") && i+1 < argc) { o.evict_bytes = parse_size(argv[++i]); }
+        else if (!strcmp(argv[i], "--ghz") && i+1 < argc) { ghz = atof(argv[++i]); }
+        else if (!strcmp(argv[i], "--check-only")) { check_only = 1; }
+        else if (!strcmp(argv[i], "--autotune") && i+1 < argc) { tune = argv[++i]; }
+        else { usage(argv[0]); return 1; }
+    }
+    if (min_size < 1 || max_size < min_size || o.reps < 1 || ghz <= 0) { usage(argv[0]); return 1; }
+    // bench_one never takes fewer than 3 samples; the arrays must hold them
+    if (o.reps < 3) o.reps = 3;
+
+    if (tune != NULL) {
+        int rc = chacha20_autotune(strcmp(tune, "-") ? tune : NULL);
+        printf("autotune: %s\n", rc == 0 ? "loaded from cache" :
+                                  rc == 1 ? "calibrated" : "calibrated, cache not written");
+        for (size_t size = min_size; size <= max_size; size *= 4) {
+            printf("  best(%zu) -> %s\n", size, chacha20_path_for_len(size));
+            if (size > max_size / 4) break;
+        }
+    }
+
+    // Known answers first: only kernels that pass are timed
+    int ok[sizeof(KERNELS) / sizeof(KERNELS[0])];
+    int failures = 0;
+    for (size_t k = 0; k < N_KERNELS; k++) {
+        int wanted = n_only == 0;
+        for (int j = 0; j < n_only; j++) wanted |= !strcmp(only[j], KERNELS[k].name);
+        ok[k] = 0;
+        if (!wanted) continue;
+        if (!kernel_usable(&KERNELS[k])) {
+            printf("%-13s skipped (no %s on this CPU)\n", KERNELS[k].name, KERNELS[k].cpu);
+            continue;
+        }
+        if (check_kernel(&KERNELS[k]) != 0) {
+            printf("%-13s FAILED RFC 8439 known-answer check\n", KERNELS[k].name);
+            failures++;
+            continue;
+        }
+        printf("%-13s RFC 8439 known answers ok\n", KERNELS[k].name);
+        ok[k] = 1;
+    }
+    if (check_poly1305() != 0) {
+        printf("%-13s FAILED RFC 8439 known-answer check\n", "poly1305");
+        failures++;
+    } else {
+        printf("%-13s RFC 8439 known answers ok\n", "poly1305");
+    }
+    if (check_aead() != 0) {
+        printf("%-13s FAILED RFC 8439 known-answer check\n", "aead");
+        failures++;
+    } else {
+        printf("%-13s RFC 8439 known answers ok\n", "aead");
+    }
+    if (check_secretbox() != 0) {
+        printf("%-13s FAILED libsodium known-answer check\n", "secretbox");
+        failures++;
+    } else {
+        printf("%-13s libsodium known answers ok\n", "secretbox");
+    }
+    if (check_scrypt() != 0) {
+        printf("%-13s FAILED RFC 7914 known-answer check\n", "scrypt");
+        failures++;
+    } else {
+        printf("%-13s RFC 7914 known answers ok\n", "scrypt");
+    }
+    if (check_only) return failures ? 1 : 0;
+
+    uint8_t *buf = aligned_alloc(64, ((max_size + 1 + 63) / 64) * 64);
+    uint8_t *evict_buf = o.cold ? malloc(o.evict_bytes) : NULL;
+    double *cpb = malloc(o.reps * sizeof(double));
+    double *ns = malloc(o.reps * sizeof(double));
+    if (!buf || (o.cold && !evict_buf) || !cpb || !ns) { fprintf(stderr, "OOM\n"); return 1; }
+    memset(buf, 0x5c, max_size + 1);
+    if (evict_buf) memset(evict_buf, 0, o.evict_bytes);
+
+    printf("\n%-13s %10s  %-5s %-5s %5s | %8s %8s %8s | %7s %7s %7s\n",
+           "kernel", "bytes", "cache", "buf", "n",
+           "cpb min", "cpb med", "cpb p99", "GB/s", "med", "p99");
+    for (size_t size = min_size; size <= max_size; size *= 4) {
+        for (size_t k = 0; k < N_KERNELS; k++) {
+            if (!ok[k]) continue;
+            for (int cold = 0; cold <= 1; cold++) {
+                if (cold ? !o.cold : !o.hot) continue;
+                for (int mis = 0; mis <= 1; mis++) {
+                    bench_one(&KERNELS[k], buf, size, cold, mis, evict_buf, &o, cpb, ns);
+                }
+            }
+        }
+        if (size > max_size / 4) break;  // next step would overflow past max
+    }
+
+    free(buf);
+    free(evict_buf);
+    free(cpb);
+    free(ns);
+    return failures ? 1 : 0;
+}
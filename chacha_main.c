@@ -2,9 +2,7 @@
 #include <stdint.h>
 #include <string.h>
 
-// forward declaration
-void chacha20_xor_best(uint8_t *out, const uint8_t *in, size_t len,
-                       const uint8_t key[32], const uint8_t nonce[12], uint32_t counter);
+#include "chacha20_simd.h"
 
 int main(void) {
     // 256-bit key (here all zero for demo) and 96-bit nonce
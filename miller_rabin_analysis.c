@@ -10,6 +10,8 @@
 #include <math.h>
 #include <string.h>
 
+#include "chacha20_rng_gmp.h"
+
 // --- portable timing includes ---
 #if defined(__x86_64__) || defined(_M_X64)
   #include <x86intrin.h>  // for rdtsc on x86 CPUs
@@ -29,8 +31,7 @@
 // This increases the chance of Miller–Rabin liars in single-round sampling.
 #define FORCE_T 12  // 2^12 = 4096; you can raise to 14/16 for even more liars
 
-// Global random state
-gmp_randstate_t global_state;
+// Random witnesses and primes come from the ChaCha20 CSPRNG (chacha20_rng.c)
 
 // Timing utilities (portable rdtsc-like)
 static inline unsigned long long rdtsc(void) {
@@ -74,7 +75,7 @@ int miller_rabin_single_round(const mpz_t n, const mpz_t d, unsigned int s, mpz_
     mpz_t range;
     mpz_init(range);
     mpz_sub_ui(range, n, 3);  // n-3 for range [0, n-4]
-    mpz_urandomm(witness, global_state, range);
+    chacha_rng_mpz_below(witness, range);
     mpz_add_ui(witness, witness, 2);  // shift to [2, n-2]
     mpz_clear(range);
 
@@ -166,7 +167,7 @@ static void generate_prime_congruent_1_mod_2T(mpz_t prime, unsigned int bits, in
     for (;;) {
         attempts++;
         // random odd with top bit set
-        mpz_urandomb(prime, global_state, bits);
+        chacha_rng_mpz_bits(prime, bits);
         mpz_setbit(prime, bits - 1);
 
         // force p ≡ 1 (mod 2^FORCE_T)
@@ -197,7 +198,7 @@ void generate_prime(mpz_t prime, unsigned int bits, int rounds) {
 
     do {
         attempts++;
-        mpz_urandomb(prime, global_state, bits);
+        chacha_rng_mpz_bits(prime, bits);
         mpz_setbit(prime, bits - 1);  // Ensure full bit length
         mpz_setbit(prime, 0);         // Make odd
         if (mpz_cmp_ui(prime, 3) <= 0) continue;
@@ -408,10 +409,7 @@ void print_theoretical_analysis(void) {
 //==============================================================================
 
 int main(void) {
-    // Initialize random number generator
     double err = 4.561e-05;;
-    gmp_randinit_mt(global_state);
-    gmp_randseed_ui(global_state, (unsigned long)(time(NULL) ^ clock()));
 
     printf("Miller-Rabin Primality Test - Comprehensive Analysis\n");
     printf("====================================================\n");
@@ -463,7 +461,6 @@ int main(void) {
 
     // Cleanup
     mpz_clears(p, q, n, NULL);
-    gmp_randclear(global_state);
 
     return 0;
 }
@@ -471,4 +468,4 @@ int main(void) {
 // Build (Apple Silicon / Homebrew):
 // clang -O3 -std=c11 -flto -fomit-frame-pointer \
 //   -I/opt/homebrew/include -L/opt/homebrew/lib \
-//   -o mr_analysis miller_rabin_analysis.c -lgmp
\ No newline at end of file
+//   -o mr_analysis miller_rabin_analysis.c chacha20_rng.c chacha20_simd.c -lgmp -pthread
\ No newline at end of file
@@ -5,7 +5,9 @@
 // Build (Apple Silicon / Homebrew):
 //   clang -O3 -flto -mcpu=apple-m1 -std=c11 \
 //     -I/opt/homebrew/include -L/opt/homebrew/lib \
-//     -o mr_gmp_bench mr_gmp_bench.c -lgmp
+//     -o mr_gmp_bench mr_gmp_bench.c chacha20_rng.c chacha20_simd.c -lgmp -pthread
+//
+// Candidates and random bases come from the ChaCha20 CSPRNG (chacha20_rng.c).
 //
 // Examples:
 //   ./mr_gmp_bench
@@ -22,6 +24,8 @@
 #include <string.h>
 #include <time.h>
 
+#include "chacha20_rng_gmp.h"
+
 #if defined(__APPLE__)
   #include <mach/mach_time.h>
 #endif
@@ -121,7 +125,7 @@ static inline int mr_strong_test_base(const mpz_t n, mr_ctx* c) {
 
 // Probable-prime test with k fixed small bases then (rounds-k) random bases.
 // Returns 1 probable prime, 0 composite.
-static inline int is_probable_prime_mr(const mpz_t n, int rounds, gmp_randstate_t rng, mr_ctx* c) {
+static inline int is_probable_prime_mr(const mpz_t n, int rounds, mr_ctx* c) {
     if (small_sieve_composite(n)) return 0;
 
     split_n_minus_1(n, c);
@@ -139,7 +143,7 @@ static inline int is_probable_prime_mr(const mpz_t n, int rounds, gmp_randstate_
 
     // Random bases in [2, n-2]
     for (int i = K; i < rounds; ++i) {
-        mpz_urandomm(c->a, rng, c->n_minus_3);
+        chacha_rng_mpz_below(c->a, c->n_minus_3);
         mpz_add_ui(c->a, c->a, 2);
         if (!mr_strong_test_base(n, c)) return 0;
     }
@@ -148,8 +152,8 @@ static inline int is_probable_prime_mr(const mpz_t n, int rounds, gmp_randstate_
 
 // ===================== Random candidates, CLI, printing =====================
 
-static inline void rand_odd_bigint(mpz_t x, gmp_randstate_t rng, unsigned bits) {
-    mpz_urandomb(x, rng, bits);
+static inline void rand_odd_bigint(mpz_t x, unsigned bits) {
+    chacha_rng_mpz_bits(x, bits);
     mpz_setbit(x, bits-1); // ensure exact bitlength
     mpz_setbit(x, 0);      // odd
 }
@@ -183,11 +187,6 @@ int main(int argc, char** argv) {
     }
     if (count <= 0 || bits < 16 || rounds < 1) { usage(argv[0]); return 1; }
 
-    // RNG
-    gmp_randstate_t rng;
-    gmp_randinit_default(rng);
-    gmp_randseed_ui(rng, (unsigned long)time(NULL));
-
     mpz_t n; mpz_init(n);
     mr_ctx ctx; mr_ctx_init(&ctx);
 
@@ -201,7 +200,7 @@ int main(int argc, char** argv) {
     char* hexbuf = NULL;
 
     for (int i = 0; i < count; ++i) {
-        rand_odd_bigint(n, rng, bits);
+        rand_odd_bigint(n, bits);
 
         unsigned long long t0 = read_cycles();
         int is_pp;
@@ -209,7 +208,7 @@ int main(int argc, char** argv) {
             // reps=rounds maps to MR repetitions inside GMP; 12 is strong for 512-bit.
             is_pp = mpz_probab_prime_p(n, rounds) > 0;
         } else {
-            is_pp = is_probable_prime_mr(n, rounds, rng, &ctx);
+            is_pp = is_probable_prime_mr(n, rounds, &ctx);
         }
         unsigned long long t1 = read_cycles();
 
@@ -243,6 +242,5 @@ int main(int argc, char** argv) {
     free(t);
     mr_ctx_clear(&ctx);
     mpz_clear(n);
-    gmp_randclear(rng);
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,340 @@
+// poly1305.c
+// Poly1305 one-time authenticator (RFC 8439 section 2.5) with two paths:
+//   poly1305_blocks: scalar, radix 2^44 (3 limbs, 64x64->128 multiplies)
+//   poly1305_blocks_avx2: 4 blocks per step in radix 2^26 (5 limbs), one
+//       block per 64-bit lane, for long messages on x86_64 with AVX2
+// poly1305_update picks the AVX2 path at runtime (CPUID) once at least
+// POLY1305_AVX2_MIN_BLOCKS full blocks are available.
+//
+// Build: gcc -O3 -std=c11 -c poly1305.c   (needs unsigned __int128)
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "arx_simd.h"
+#include "poly1305.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+  #include <immintrin.h>
+  #define HAVE_X86 1
+#else
+  #define HAVE_X86 0
+#endif
+
+// Fewest blocks worth the 2^44 <-> 2^26 conversion of the AVX2 path
+#ifndef POLY1305_AVX2_MIN_BLOCKS
+#define POLY1305_AVX2_MIN_BLOCKS 16
+#endif
+
+typedef unsigned __int128 u128;
+
+#define MASK44 0xfffffffffffULL
+#define MASK42 0x3ffffffffffULL
+#define MASK26 0x3ffffffULL
+
+// little-endian 64-bit load/store
+static inline uint64_t load64_le(const uint8_t *p) {
+    return (uint64_t)p[0]
+         | ((uint64_t)p[1] << 8)
+         | ((uint64_t)p[2] << 16)
+         | ((uint64_t)p[3] << 24)
+         | ((uint64_t)p[4] << 32)
+         | ((uint64_t)p[5] << 40)
+         | ((uint64_t)p[6] << 48)
+         | ((uint64_t)p[7] << 56);
+}
+static inline void store64_le(uint8_t *p, uint64_t v) {
+    for (int i = 0; i < 8; i++) {
+        p[i] = (uint8_t)(v >> (8 * i));
+    }
+}
+
+//poly1305_mul44(h, r):
+//  h = h * r mod 2^130-5, partially reduced. Limbs of r above 2^130 wrap
+//  back multiplied by 5; the extra factor 4 in s1/s2 accounts for the
+//  limbs being 44/44/42 bits wide (2^132 = 4 * 2^130).
+static void poly1305_mul44(uint64_t h[3], const uint64_t r[3]) {
+    uint64_t s1 = r[1] * (5 << 2);
+    uint64_t s2 = r[2] * (5 << 2);
+    u128 d0 = (u128)h[0] * r[0] + (u128)h[1] * s2   + (u128)h[2] * s1;
+    u128 d1 = (u128)h[0] * r[1] + (u128)h[1] * r[0] + (u128)h[2] * s2;
+    u128 d2 = (u128)h[0] * r[2] + (u128)h[1] * r[1] + (u128)h[2] * r[0];
+    uint64_t c;
+    c = (uint64_t)(d0 >> 44); h[0] = (uint64_t)d0 & MASK44; d1 += c;
+    c = (uint64_t)(d1 >> 44); h[1] = (uint64_t)d1 & MASK44; d2 += c;
+    c = (uint64_t)(d2 >> 42); h[2] = (uint64_t)d2 & MASK42;
+    h[0] += c * 5;
+    c = h[0] >> 44; h[0] &= MASK44;
+    h[1] += c;
+}
+
+// Scalar path: absorb len/16 full blocks, hibit = 2^128 for full blocks
+static void poly1305_blocks(poly1305_ctx *ctx, const uint8_t *m, size_t len,
+                            uint64_t hibit) {
+    uint64_t h[3] = { ctx->h[0], ctx->h[1], ctx->h[2] };
+    while (len >= 16) {
+        uint64_t t0 = load64_le(m + 0);
+        uint64_t t1 = load64_le(m + 8);
+        h[0] += t0 & MASK44;
+        h[1] += ((t0 >> 44) | (t1 << 20)) & MASK44;
+        h[2] += ((t1 >> 24) & MASK42) | hibit;
+        poly1305_mul44(h, ctx->r);
+        m += 16;
+        len -= 16;
+    }
+    ctx->h[0] = h[0];
+    ctx->h[1] = h[1];
+    ctx->h[2] = h[2];
+}
+
+#if HAVE_X86
+// Carry h so every limb is exactly 44/44/42 bits (value may still be >= p)
+static void poly1305_norm44(uint64_t h[3]) {
+    uint64_t c;
+    c = h[0] >> 44; h[0] &= MASK44; h[1] += c;
+    c = h[1] >> 44; h[1] &= MASK44; h[2] += c;
+    c = h[2] >> 42; h[2] &= MASK42; h[0] += c * 5;
+    c = h[0] >> 44; h[0] &= MASK44; h[1] += c;
+    c = h[1] >> 44; h[1] &= MASK44; h[2] += c;
+}
+
+// Radix conversions between 3x44 and 5x26 bit limbs
+static void poly1305_44_to_26(uint32_t l[5], const uint64_t h_in[3]) {
+    uint64_t h[3] = { h_in[0], h_in[1], h_in[2] };
+    poly1305_norm44(h);
+    l[0] = (uint32_t)(h[0] & MASK26);
+    l[1] = (uint32_t)(((h[0] >> 26) | (h[1] << 18)) & MASK26);
+    l[2] = (uint32_t)((h[1] >> 8) & MASK26);
+    l[3] = (uint32_t)(((h[1] >> 34) | (h[2] << 10)) & MASK26);
+    l[4] = (uint32_t)(h[2] >> 16);
+}
+
+static void poly1305_26_to_44(uint64_t h[3], const uint64_t l_in[5]) {
+    uint64_t l[5] = { l_in[0], l_in[1], l_in[2], l_in[3], l_in[4] };
+    uint64_t c;
+    c = l[0] >> 26; l[0] &= MASK26; l[1] += c;
+    c = l[1] >> 26; l[1] &= MASK26; l[2] += c;
+    c = l[2] >> 26; l[2] &= MASK26; l[3] += c;
+    c = l[3] >> 26; l[3] &= MASK26; l[4] += c;
+    c = l[4] >> 26; l[4] &= MASK26; l[0] += c * 5;
+    c = l[0] >> 26; l[0] &= MASK26; l[1] += c;
+    // second pass so l[0..3] are exactly 26 bits and the ORs below are exact
+    c = l[1] >> 26; l[1] &= MASK26; l[2] += c;
+    c = l[2] >> 26; l[2] &= MASK26; l[3] += c;
+    c = l[3] >> 26; l[3] &= MASK26; l[4] += c;
+    h[0] = (l[0] | (l[1] << 26)) & MASK44;
+    h[1] = ((l[1] >> 18) | (l[2] << 8) | (l[3] << 34)) & MASK44;
+    h[2] = (l[3] >> 10) | (l[4] << 16);
+}
+
+// r^1..r^4 for the vector path, computed on first use
+static void poly1305_powers(poly1305_ctx *ctx) {
+    uint64_t p[3] = { ctx->r[0], ctx->r[1], ctx->r[2] };
+    poly1305_44_to_26(ctx->rpow[0], p);
+    for (int k = 1; k < 4; k++) {
+        poly1305_mul44(p, ctx->r);
+        poly1305_44_to_26(ctx->rpow[k], p);
+    }
+    ctx->have_rpow = 1;
+}
+
+// AVX2_MUL26(d, h, r, s):
+//   d = h * r mod 2^130-5 in each 64-bit lane, radix 2^26. s holds 5*r for
+//   the limbs that wrap past 2^130. vpmuludq only reads the low 32 bits of
+//   each lane, which is all a 26-bit limb needs.
+#define MUL(a, b) _mm256_mul_epu32(a, b)
+#define ADD(a, b) _mm256_add_epi64(a, b)
+#define AVX2_MUL26(d, h, r, s)                                                                      \
+    do {                                                                                            \
+        d[0] = ADD(ADD(ADD(MUL(h[0], r[0]), MUL(h[1], s[4])), ADD(MUL(h[2], s[3]), MUL(h[3], s[2]))), MUL(h[4], s[1])); \
+        d[1] = ADD(ADD(ADD(MUL(h[0], r[1]), MUL(h[1], r[0])), ADD(MUL(h[2], s[4]), MUL(h[3], s[3]))), MUL(h[4], s[2])); \
+        d[2] = ADD(ADD(ADD(MUL(h[0], r[2]), MUL(h[1], r[1])), ADD(MUL(h[2], r[0]), MUL(h[3], s[4]))), MUL(h[4], s[3])); \
+        d[3] = ADD(ADD(ADD(MUL(h[0], r[3]), MUL(h[1], r[2])), ADD(MUL(h[2], r[1]), MUL(h[3], r[0]))), MUL(h[4], s[4])); \
+        d[4] = ADD(ADD(ADD(MUL(h[0], r[4]), MUL(h[1], r[3])), ADD(MUL(h[2], r[2]), MUL(h[3], r[1]))), MUL(h[4], r[0])); \
+    } while (0)
+
+// Partial carry of 5 lane vectors back to ~26 bits per limb
+#define AVX2_CARRY26(d, m26)                                                        \
+    do {                                                                            \
+        __m256i c_;                                                                 \
+        c_ = _mm256_srli_epi64(d[0], 26); d[0] = _mm256_and_si256(d[0], m26); d[1] = ADD(d[1], c_); \
+        c_ = _mm256_srli_epi64(d[1], 26); d[1] = _mm256_and_si256(d[1], m26); d[2] = ADD(d[2], c_); \
+        c_ = _mm256_srli_epi64(d[2], 26); d[2] = _mm256_and_si256(d[2], m26); d[3] = ADD(d[3], c_); \
+        c_ = _mm256_srli_epi64(d[3], 26); d[3] = _mm256_and_si256(d[3], m26); d[4] = ADD(d[4], c_); \
+        c_ = _mm256_srli_epi64(d[4], 26); d[4] = _mm256_and_si256(d[4], m26);       \
+        d[0] = ADD(d[0], ADD(c_, _mm256_slli_epi64(c_, 2)));                        \
+        c_ = _mm256_srli_epi64(d[0], 26); d[0] = _mm256_and_si256(d[0], m26); d[1] = ADD(d[1], c_); \
+    } while (0)
+
+// Load 4 consecutive 16-byte blocks, block i into lane i, as 5 limbs
+__attribute__((target("avx2")))
+static inline void poly1305_load4_avx2(__m256i mv[5], const uint8_t *m, __m256i m26) {
+    __m256i a  = _mm256_loadu_si256((const __m256i *)(m + 0));
+    __m256i b  = _mm256_loadu_si256((const __m256i *)(m + 32));
+    __m256i lo = _mm256_permute4x64_epi64(_mm256_unpacklo_epi64(a, b), 0xD8);
+    __m256i hi = _mm256_permute4x64_epi64(_mm256_unpackhi_epi64(a, b), 0xD8);
+    mv[0] = _mm256_and_si256(lo, m26);
+    mv[1] = _mm256_and_si256(_mm256_srli_epi64(lo, 26), m26);
+    mv[2] = _mm256_and_si256(_mm256_or_si256(_mm256_srli_epi64(lo, 52),
+                                             _mm256_slli_epi64(hi, 12)), m26);
+    mv[3] = _mm256_and_si256(_mm256_srli_epi64(hi, 14), m26);
+    mv[4] = _mm256_or_si256(_mm256_srli_epi64(hi, 40), _mm256_set1_epi64x(1 << 24));
+}
+
+//poly1305_blocks_avx2(ctx, m, nblocks):
+//  Lane i accumulates blocks i, i+4, i+8, … as L_i = L_i * r^4 + m, with the
+//  running h folded into lane 0 first. The sequential result is
+//  L_0*r^4 + L_1*r^3 + L_2*r^2 + L_3*r, so the last step multiplies the
+//  lanes by (r^4, r^3, r^2, r) and sums them. Handles nblocks rounded down
+//  to a multiple of 4 and returns the number of bytes consumed.
+__attribute__((target("avx2")))
+static size_t poly1305_blocks_avx2(poly1305_ctx *ctx, const uint8_t *m, size_t nblocks) {
+    const __m256i m26 = _mm256_set1_epi64x(MASK26);
+    size_t groups = nblocks / 4;
+    if (!ctx->have_rpow) poly1305_powers(ctx);
+
+    __m256i r4[5], s4[5], rmix[5], smix[5];
+    for (int i = 0; i < 5; i++) {
+        r4[i] = _mm256_set1_epi64x(ctx->rpow[3][i]);
+        s4[i] = _mm256_set1_epi64x(5 * (uint64_t)ctx->rpow[3][i]);
+        rmix[i] = _mm256_set_epi64x(ctx->rpow[0][i], ctx->rpow[1][i],
+                                    ctx->rpow[2][i], ctx->rpow[3][i]);
+        smix[i] = _mm256_set_epi64x(5 * (uint64_t)ctx->rpow[0][i], 5 * (uint64_t)ctx->rpow[1][i],
+                                    5 * (uint64_t)ctx->rpow[2][i], 5 * (uint64_t)ctx->rpow[3][i]);
+    }
+
+    uint32_t h26[5];
+    poly1305_44_to_26(h26, ctx->h);
+    __m256i h[5], d[5], mv[5];
+    poly1305_load4_avx2(h, m, m26);
+    for (int i = 0; i < 5; i++) {
+        h[i] = ADD(h[i], _mm256_set_epi64x(0, 0, 0, h26[i]));
+    }
+    for (size_t g = 1; g < groups; g++) {
+        AVX2_MUL26(d, h, r4, s4);
+        AVX2_CARRY26(d, m26);
+        poly1305_load4_avx2(mv, m + 64 * g, m26);
+        for (int i = 0; i < 5; i++) {
+            h[i] = ADD(d[i], mv[i]);
+        }
+    }
+    AVX2_MUL26(d, h, rmix, smix);
+    AVX2_CARRY26(d, m26);
+
+    // Horizontal sum of the four lanes
+    uint64_t l[5];
+    for (int i = 0; i < 5; i++) {
+        uint64_t lane[4];
+        _mm256_storeu_si256((__m256i *)lane, d[i]);
+        l[i] = lane[0] + lane[1] + lane[2] + lane[3];
+    }
+    poly1305_26_to_44(ctx->h, l);
+    return groups * 64;
+}
+#undef MUL
+#undef ADD
+
+static int poly1305_have_avx2(void) {
+    static int have = -1;
+    if (have < 0) {
+        __builtin_cpu_init();
+        have = __builtin_cpu_supports("avx2") ? 1 : 0;
+    }
+    return have;
+}
+#endif
+
+//poly1305_init(ctx, key):
+//  key[0..15] is r (clamped as the RFC requires), key[16..31] is s.
+void poly1305_init(poly1305_ctx *ctx, const uint8_t key[32]) {
+    uint64_t t0 = load64_le(key + 0);
+    uint64_t t1 = load64_le(key + 8);
+    ctx->r[0] = t0 & 0xffc0fffffffULL;
+    ctx->r[1] = ((t0 >> 44) | (t1 << 20)) & 0xfffffc0ffffULL;
+    ctx->r[2] = (t1 >> 24) & 0x00ffffffc0fULL;
+    ctx->h[0] = ctx->h[1] = ctx->h[2] = 0;
+    ctx->pad[0] = load64_le(key + 16);
+    ctx->pad[1] = load64_le(key + 24);
+    ctx->leftover = 0;
+    ctx->have_rpow = 0;
+}
+
+void poly1305_update(poly1305_ctx *ctx, const uint8_t *m, size_t len) {
+    // Top up a partial block from the previous call
+    if (ctx->leftover) {
+        size_t want = 16 - ctx->leftover;
+        if (want > len) want = len;
+        memcpy(ctx->buf + ctx->leftover, m, want);
+        ctx->leftover += want;
+        m += want;
+        len -= want;
+        if (ctx->leftover < 16) return;
+        poly1305_blocks(ctx, ctx->buf, 16, 1ULL << 40);
+        ctx->leftover = 0;
+    }
+#if HAVE_X86
+    if (len / 16 >= POLY1305_AVX2_MIN_BLOCKS && poly1305_have_avx2()) {
+        size_t done = poly1305_blocks_avx2(ctx, m, len / 16);
+        m += done;
+        len -= done;
+    }
+#endif
+    if (len >= 16) {
+        size_t full = len & ~(size_t)15;
+        poly1305_blocks(ctx, m, full, 1ULL << 40);
+        m += full;
+        len -= full;
+    }
+    if (len) {
+        memcpy(ctx->buf, m, len);
+        ctx->leftover = len;
+    }
+}
+
+//poly1305_finish(ctx, mac):
+//  Pad and absorb the last partial block (a 1 byte after the data, no
+//  2^128 bit), reduce h fully mod 2^130-5 with a branch-free select, add s
+//  and write the low 128 bits. The context is wiped afterwards.
+void poly1305_finish(poly1305_ctx *ctx, uint8_t mac[16]) {
+    if (ctx->leftover) {
+        size_t i = ctx->leftover;
+        ctx->buf[i++] = 1;
+        for (; i < 16; i++) ctx->buf[i] = 0;
+        poly1305_blocks(ctx, ctx->buf, 16, 0);
+    }
+
+    uint64_t h0 = ctx->h[0], h1 = ctx->h[1], h2 = ctx->h[2], c;
+    c = h1 >> 44; h1 &= MASK44; h2 += c;
+    c = h2 >> 42; h2 &= MASK42; h0 += c * 5;
+    c = h0 >> 44; h0 &= MASK44; h1 += c;
+    c = h1 >> 44; h1 &= MASK44; h2 += c;
+    c = h2 >> 42; h2 &= MASK42; h0 += c * 5;
+    c = h0 >> 44; h0 &= MASK44; h1 += c;
+
+    // g = h + 5 - 2^130; use it if it did not go negative
+    uint64_t g0 = h0 + 5; c = g0 >> 44; g0 &= MASK44;
+    uint64_t g1 = h1 + c; c = g1 >> 44; g1 &= MASK44;
+    uint64_t g2 = h2 + c - (1ULL << 42);
+    uint64_t mask = (g2 >> 63) - 1;
+    h0 = (h0 & ~mask) | (g0 & mask);
+    h1 = (h1 & ~mask) | (g1 & mask);
+    h2 = (h2 & ~mask) | (g2 & mask);
+
+    // h + s mod 2^128
+    uint64_t t0 = ctx->pad[0], t1 = ctx->pad[1];
+    h0 += t0 & MASK44; c = h0 >> 44; h0 &= MASK44;
+    h1 += (((t0 >> 44) | (t1 << 20)) & MASK44) + c; c = h1 >> 44; h1 &= MASK44;
+    h2 += ((t1 >> 24) & MASK42) + c; h2 &= MASK42;
+    store64_le(mac + 0, h0 | (h1 << 44));
+    store64_le(mac + 8, (h1 >> 20) | (h2 << 24));
+
+    arx_wipe(ctx, sizeof(*ctx));
+}
+
+void poly1305_auth(uint8_t mac[16], const uint8_t *m, size_t len, const uint8_t key[32]) {
+    poly1305_ctx ctx;
+    poly1305_init(&ctx, key);
+    poly1305_update(&ctx, m, len);
+    poly1305_finish(&ctx, mac);
+}
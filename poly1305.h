@@ -0,0 +1,27 @@
+// poly1305.h
+// Poly1305 one-time authenticator (RFC 8439 section 2.5), see poly1305.c.
+
+#ifndef POLY1305_H
+#define POLY1305_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef struct {
+    uint64_t r[3];        // clamped r, radix 2^44
+    uint64_t h[3];        // accumulator, radix 2^44
+    uint64_t pad[2];      // s, added once at the end
+    uint8_t  buf[16];     // partial block carried between updates
+    size_t   leftover;    // bytes in buf
+    uint32_t rpow[4][5];  // r^1..r^4 in radix 2^26 for the AVX2 path
+    int      have_rpow;   // rpow is filled in on first use
+} poly1305_ctx;
+
+void poly1305_init(poly1305_ctx *ctx, const uint8_t key[32]);
+void poly1305_update(poly1305_ctx *ctx, const uint8_t *m, size_t len);
+void poly1305_finish(poly1305_ctx *ctx, uint8_t mac[16]);
+
+// One-shot MAC of a whole message
+void poly1305_auth(uint8_t mac[16], const uint8_t *m, size_t len, const uint8_t key[32]);
+
+#endif
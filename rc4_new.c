@@ -48,7 +48,7 @@ void rc4_init(RC4_CTX *ctx, const u8 *key, size_t keylen) {
  *     i <- i + 1                // 1 ADD
  *     j <- j + S[i]             // 1 LOAD, 1 ADD
  *     swap S[i] and S[j]        // 2 LOAD, 2 STORE
- *     K <- S[tmp + S[j]]        // 1 ADD, 1 LOAD
+ *     K <- S[S[i] + S[j]]       // 1 ADD, 1 LOAD
  *   Keystream uses XOR:          // 1 LOAD, 1 XOR, 1 STORE (in rc4_crypt)
  *   Total per byte: 2 ADD, 3 LOAD, 2 STORE, 1 XOR
  *
@@ -79,10 +79,10 @@ static inline __attribute__((always_inline)) u8 rc4_byte(RC4_CTX *ctx) {
     //ctx->S[j] = ctx->S[i];
     //ctx->S[i] = tmp;
 
-    // K <- S[tmp + S[j]]
+    // K <- S[S[i] + S[j]], both after the swap
     // This is the keystream byte
-    // tmp + S[j] is the index into S
-    // S[tmp + S[j]] is the keystream byte
+    // S[i] + S[j] = S[j] + tmp is the index into S
+    // S[S[i] + S[j]] is the keystream byte
     // This is the core of the PRGA
     // It generates one byte of keystream per call
     // The result is used in rc4_crypt to XOR with plaintext/ciphertext
@@ -92,7 +92,7 @@ static inline __attribute__((always_inline)) u8 rc4_byte(RC4_CTX *ctx) {
     // This is a simple and efficient way to generate the keystream
     // It uses only 8-bit arithmetic and indexing, which is fast on modern CPUs
 
-    return ctx->S[(u8)(tmp + ctx->S[j])];
+    return ctx->S[(u8)(ctx->S[i] + tmp)];
 }
 
 /**
@@ -118,9 +118,161 @@ unsigned long long rc4_crypt(RC4_CTX *ctx, u8 *data, size_t datalen) {
 #endif
 }
 
+#define RC4_MULTI_MAX 8
+
+/**
+ * rc4_lanes_tmpl(ctx, data, len, n)
+ *   rc4_byte on n independent streams in one loop: byte k of stream 0,
+ *   byte k of stream 1, ... then byte k+1. Each stream's i -> S[i] -> j ->
+ *   S[j] -> swap chain is as serial as in rc4_crypt, but the chains of
+ *   different streams do not depend on each other, so the CPU overlaps
+ *   their loads and the loop costs about one chain per n bytes.
+ *   n is a constant in every instance below, so the stream loop unrolls
+ *   and i, j stay in locals. Contexts must be distinct.
+ */
+static inline __attribute__((always_inline))
+void rc4_lanes_tmpl(RC4_CTX *const *ctx, u8 *const *data, size_t len, int n) {
+    u8 *S[RC4_MULTI_MAX];
+    u8 i[RC4_MULTI_MAX], j[RC4_MULTI_MAX];
+    for (int s = 0; s < n; s++) {
+        S[s] = ctx[s]->S;
+        i[s] = ctx[s]->i;
+        j[s] = ctx[s]->j;
+    }
+    for (size_t k = 0; k < len; k++) {
+        for (int s = 0; s < n; s++) {
+            u8 ii = (u8)(i[s] + 1);
+            u8 si = S[s][ii];
+            u8 jj = (u8)(j[s] + si);
+            u8 sj = S[s][jj];
+            S[s][ii] = sj;
+            S[s][jj] = si;
+            data[s][k] ^= S[s][(u8)(si + sj)];
+            i[s] = ii;
+            j[s] = jj;
+        }
+    }
+    for (int s = 0; s < n; s++) {
+        ctx[s]->i = i[s];
+        ctx[s]->j = j[s];
+    }
+}
+
+// rc4_lanes_tmpl instantiated for every stream count rc4_crypt_multi takes
+#define RC4_LANES(n)                                                        \
+    static void rc4_lanes_##n(RC4_CTX *const *ctx, u8 *const *data,         \
+                              size_t len) {                                 \
+        rc4_lanes_tmpl(ctx, data, len, n);                                  \
+    }
+RC4_LANES(1) RC4_LANES(2) RC4_LANES(3) RC4_LANES(4)
+RC4_LANES(5) RC4_LANES(6) RC4_LANES(7) RC4_LANES(8)
+
+/**
+ * rc4_crypt_multi(ctx, data, len, n) PRGA ROUND, n streams
+ *   Same result for every stream s < n (n at most RC4_MULTI_MAX) as
+ *   rc4_crypt(ctx[s], data[s], len[s]). The common length runs through
+ *   rc4_lanes_tmpl, the rest of the longer streams one at a time.
+ *   Returns the cycles (clock ticks without GCC) of the whole call.
+ */
+unsigned long long rc4_crypt_multi(RC4_CTX *const *ctx, u8 *const *data,
+                                   const size_t *len, int n) {
+#ifdef __GNUC__
+    unsigned long long start = __rdtsc();
+#else
+    clock_t start = clock();
+#endif
+    size_t common = n > 0 ? len[0] : 0;
+    for (int s = 1; s < n; s++) {
+        if (len[s] < common) common = len[s];
+    }
+    switch (n) {
+    case 8: rc4_lanes_8(ctx, data, common); break;
+    case 7: rc4_lanes_7(ctx, data, common); break;
+    case 6: rc4_lanes_6(ctx, data, common); break;
+    case 5: rc4_lanes_5(ctx, data, common); break;
+    case 4: rc4_lanes_4(ctx, data, common); break;
+    case 3: rc4_lanes_3(ctx, data, common); break;
+    case 2: rc4_lanes_2(ctx, data, common); break;
+    case 1: rc4_lanes_1(ctx, data, common); break;
+    default: common = 0; break;
+    }
+    for (int s = 0; s < n; s++) {
+        for (size_t k = common; k < len[s]; k++) {
+            data[s][k] ^= rc4_byte(ctx[s]);
+        }
+    }
+#ifdef __GNUC__
+    return __rdtsc() - start;
+#else
+    return (unsigned long long)(clock() - start);
+#endif
+}
+
+/**
+ * rc4_bench(streams, len)
+ *   Encrypt `streams` buffers of len bytes under different keys one after
+ *   the other with rc4_crypt and then together with rc4_crypt_multi,
+ *   check both give the same ciphertexts and print cycles/byte.
+ */
+static int rc4_bench(int streams, size_t len) {
+    RC4_CTX ctx1[RC4_MULTI_MAX], ctxn[RC4_MULTI_MAX];
+    RC4_CTX *pn[RC4_MULTI_MAX] = { NULL };
+    u8 *d1[RC4_MULTI_MAX] = { NULL }, *dn[RC4_MULTI_MAX] = { NULL };
+    size_t lens[RC4_MULTI_MAX] = { 0 };
+    unsigned long long c1 = 0;
+
+    for (int s = 0; s < streams; s++) {
+        u8 key[16];
+        for (int b = 0; b < 16; b++) key[b] = (u8)(s * 16 + b + 1);
+        rc4_init(&ctx1[s], key, sizeof(key));
+        ctxn[s] = ctx1[s];
+        pn[s] = &ctxn[s];
+        d1[s] = (u8 *)malloc(len);
+        dn[s] = (u8 *)malloc(len);
+        if (d1[s] == NULL || dn[s] == NULL) {
+            fprintf(stderr, "out of memory\n");
+            return 1;
+        }
+        for (size_t k = 0; k < len; k++) d1[s][k] = dn[s][k] = (u8)(k * 7 + s);
+        lens[s] = len;
+    }
+    for (int s = 0; s < streams; s++) {
+        c1 += rc4_crypt(&ctx1[s], d1[s], len);
+    }
+    unsigned long long cn = rc4_crypt_multi(pn, dn, lens, streams);
+
+    int same = 1;
+    for (int s = 0; s < streams; s++) {
+        if (memcmp(d1[s], dn[s], len) != 0 || ctx1[s].i != ctxn[s].i ||
+            ctx1[s].j != ctxn[s].j || memcmp(ctx1[s].S, ctxn[s].S, 256) != 0) {
+            same = 0;
+        }
+        free(d1[s]);
+        free(dn[s]);
+    }
+    double bytes = (double)streams * (double)len;
+    printf("%d streams x %zu bytes: one at a time %.2f cycles/byte, "
+           "interleaved %.2f cycles/byte, output %s\n",
+           streams, len, (double)c1 / bytes, (double)cn / bytes,
+           same ? "identical" : "DIFFERS");
+    return same ? 0 : 1;
+}
+
 int main(int argc, char **argv) {
+    if (argc >= 2 && !strcmp(argv[1], "--bench")) {
+        int streams = argc >= 3 ? atoi(argv[2]) : RC4_MULTI_MAX;
+        size_t len = argc >= 4 ? (size_t)atol(argv[3]) : (size_t)1 << 20;
+        if (streams < 1 || streams > RC4_MULTI_MAX || len == 0) {
+            fprintf(stderr, "Usage: %s --bench [streams 1..%d] [bytes]\n",
+                    argv[0], RC4_MULTI_MAX);
+            return 1;
+        }
+        return rc4_bench(streams, len);
+    }
     if (argc != 3) {
-        fprintf(stderr, "Usage: %s <key> <plaintext>\n", argv[0]);
+        fprintf(stderr, "Usage: %s <key> <plaintext>\n"
+                        "       %s --bench [streams 1..%d] [bytes]\n",
+                argv[0], argv[0], RC4_MULTI_MAX);
         return 1;
     }
 
@@ -149,4 +301,5 @@ int main(int argc, char **argv) {
 
     //compile with this command: $gcc -O3 -march=native -std=c11 -o rc4_new rc4_new.c /* That command invokes GCC to compile rc4_new.c with optimization level 3 targeting your native CPU and C11 standard and produces an executable named rc4_new. */
     //usage: $./rc4_new <key> <message>
+    //       $./rc4_new --bench [streams] [bytes]   (rc4_crypt vs rc4_crypt_multi)
 }
\ No newline at end of file
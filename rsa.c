@@ -1,11 +1,15 @@
 // rsa_gmp.c
 // RSA key‐generation and string encrypt/decrypt using GMP for a ~1024‐bit modulus.
+// Prime candidates come from the ChaCha20 CSPRNG (chacha20_rng.c).
+//
+// Build: gcc -O3 -std=c11 -pthread -o rsa rsa.c chacha20_rng.c chacha20_simd.c -lgmp
 
 #include <gmp.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <time.h>
+
+#include "chacha20_rng_gmp.h"
 
 #define PRIME_BITS   1024      // each prime ~512 bits → N ~1024 bits
 #define MR_ROUNDS     25      // Miller–Rabin rounds for primality testing
@@ -13,23 +17,19 @@
 
 int main(void) {
     // --- 1) Key generation ---
-    gmp_randstate_t state;
     mpz_t p, q, n, phi, e, d, g, tmp;
     mpz_inits(p, q, n, phi, e, d, g, tmp, NULL);
 
-    gmp_randinit_default(state);
-    gmp_randseed_ui(state, (unsigned long)time(NULL));
-
     // generate prime p
     do {
-        mpz_urandomb(p, state, PRIME_BITS);
+        chacha_rng_mpz_bits(p, PRIME_BITS);
         mpz_setbit(p, PRIME_BITS-1);
         mpz_setbit(p, 0);
     } while (!mpz_probab_prime_p(p, MR_ROUNDS));
 
     // generate prime q ≠ p
     do {
-        mpz_urandomb(q, state, PRIME_BITS);
+        chacha_rng_mpz_bits(q, PRIME_BITS);
         mpz_setbit(q, PRIME_BITS-1);
         mpz_setbit(q, 0);
     } while (!mpz_probab_prime_p(q, MR_ROUNDS) || mpz_cmp(p, q) == 0);
@@ -110,6 +110,5 @@ int main(void) {
     // cleanup
     free(out);
     mpz_clears(p, q, n, phi, e, d, g, tmp, m, c, m2, NULL);
-    gmp_randclear(state);
     return 0;
 }
\ No newline at end of file
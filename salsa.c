@@ -1,85 +1,96 @@
 // salsa20.c
-// Simple Salsa20/20 implementation: core + single‐stream XOR
+// Simple Salsa20 implementation: core + single‐stream XOR, generated for
+// Salsa20/20 (salsa20_core, salsa20_xor) and the reduced-round Salsa20/12
+// and Salsa20/8 (salsa12_*, salsa8_*), plus multi-block SIMD kernels:
+//   salsa20_xor_sse2: 4 blocks per pass, one block per __m128i lane
+//   salsa20_xor_avx2: 8 blocks per pass on AVX2
+//   salsa20_xor_avx512: 16 blocks per pass on AVX-512F (vprold rotates)
+//   salsa20_xor_neon4: 4 blocks per pass on ARM NEON
+//   salsaR_xor_best: runtime dispatch to the widest of those the CPU has
+//   salsa20_djb_xor: Bernstein/NaCl layout, 64-bit nonce and counter
+//   hsalsa20 / xsalsa20_xor: 192-bit nonce variant (secretbox)
+//   salsa_core / salsa_core_lanes: the core on word blocks, any round
+//     count, one block or several at once in SIMD lanes (scrypt)
+//
+// Build: gcc -O3 -std=c11 -c salsa.c
 
 #include <stdint.h>
 #include <stddef.h>
 #include <string.h>
 
-// 32‐bit left rotate
-static inline uint32_t ROTL32(uint32_t x, int r) {
-    return (x << r) | (x >> (32 - r));
-}
+#include "salsa.h"
+#include "arx_simd.h"   // ROTL32, load32_le / store32_le, transposes
 
-// load/store little‐endian 32‐bit words
-static inline uint32_t load32_le(const uint8_t *p) {
-    return (uint32_t)p[0]
-         | ((uint32_t)p[1] << 8)
-         | ((uint32_t)p[2] << 16)
-         | ((uint32_t)p[3] << 24);
-}
-static inline void store32_le(uint8_t *p, uint32_t v) {
-    p[0] = (uint8_t)v;
-    p[1] = (uint8_t)(v >> 8);
-    p[2] = (uint8_t)(v >> 16);
-    p[3] = (uint8_t)(v >> 24);
-}
+/*
+ * SALSA_ROUNDS(rounds)
+ *   `rounds` rounds (column + row double rounds) on scalar locals x0..x15,
+ *   which must be in scope. Shared by the block function and hsalsa20,
+ *   which differ only in what they do with the result.
+ */
+#define SALSA_ROUNDS(rounds)                                                \
+    do {                                                                    \
+        ARX_UNROLL                                                        \
+        for (int i_ = 0; i_ < (rounds); i_ += 2) {                          \
+            /* odd round: columns */                                        \
+            x4  ^= ROTL32(x0  + x12, 7);                                    \
+            x8  ^= ROTL32(x4  + x0,  9);                                    \
+            x12 ^= ROTL32(x8  + x4,  13);                                   \
+            x0  ^= ROTL32(x12 + x8,  18);                                   \
+                                                                            \
+            x9  ^= ROTL32(x5  + x1,  7);                                    \
+            x13 ^= ROTL32(x9  + x5,  9);                                    \
+            x1  ^= ROTL32(x13 + x9,  13);                                   \
+            x5  ^= ROTL32(x1  + x13, 18);                                   \
+                                                                            \
+            x14 ^= ROTL32(x10 + x6,  7);                                    \
+            x2  ^= ROTL32(x14 + x10, 9);                                    \
+            x6  ^= ROTL32(x2  + x14, 13);                                   \
+            x10 ^= ROTL32(x6  + x2,  18);                                   \
+                                                                            \
+            x3  ^= ROTL32(x15 + x11, 7);                                    \
+            x7  ^= ROTL32(x3  + x15, 9);                                    \
+            x11 ^= ROTL32(x7  + x3,  13);                                   \
+            x15 ^= ROTL32(x11 + x7,  18);                                   \
+                                                                            \
+            /* even round: rows */                                          \
+            x1  ^= ROTL32(x0  + x3,  7);                                    \
+            x2  ^= ROTL32(x1  + x0,  9);                                    \
+            x3  ^= ROTL32(x2  + x1,  13);                                   \
+            x0  ^= ROTL32(x3  + x2,  18);                                   \
+                                                                            \
+            x6  ^= ROTL32(x5  + x4,  7);                                    \
+            x7  ^= ROTL32(x6  + x5,  9);                                    \
+            x4  ^= ROTL32(x7  + x6,  13);                                   \
+            x5  ^= ROTL32(x4  + x7,  18);                                   \
+                                                                            \
+            x11 ^= ROTL32(x10 + x9,  7);                                    \
+            x8  ^= ROTL32(x11 + x10, 9);                                    \
+            x9  ^= ROTL32(x8  + x11, 13);                                   \
+            x10 ^= ROTL32(x9  + x8,  18);                                   \
+                                                                            \
+            x12 ^= ROTL32(x15 + x14, 7);                                    \
+            x13 ^= ROTL32(x12 + x15, 9);                                    \
+            x14 ^= ROTL32(x13 + x12, 13);                                   \
+            x15 ^= ROTL32(x14 + x13, 18);                                   \
+        }                                                                   \
+    } while (0)
 
 /*
- * salsa20_core(out, in)
- *   input: 16 × 32-bit words  = constant + key + counter + nonce
+ * salsa_core_tmpl(out, in, rounds)
+ *   input: 16 × 32-bit words  = constant + key + counter + nonce
  *   output: 64 bytes = 16 words little‐endian
- *   Performs 20 rounds = 10 double‐rounds of the Salsa quarter‐round.
+ *   Performs `rounds` rounds = rounds/2 double‐rounds of the Salsa
+ *   quarter‐round. Always inlined into the fixed-round instances below.
  */
-static void salsa20_core(uint8_t out[64], const uint32_t in[16]) {
+static inline __attribute__((always_inline))
+void salsa_core_tmpl(uint8_t out[64], const uint32_t in[16], int rounds) {
     // copy input to working regs
     uint32_t x0 = in[0],  x1 = in[1],  x2 = in[2],  x3 = in[3];
     uint32_t x4 = in[4],  x5 = in[5],  x6 = in[6],  x7 = in[7];
     uint32_t x8 = in[8],  x9 = in[9],  x10 = in[10], x11 = in[11];
     uint32_t x12 = in[12], x13 = in[13], x14 = in[14], x15 = in[15];
 
-    for (int i = 0; i < 10; i++) {
-        // odd round: columns
-        x4 ^= ROTL32(x0 + x12, 7);
-        x8 ^= ROTL32(x4 + x0, 9);
-        x12 ^= ROTL32(x8 + x4, 13);
-        x0 ^= ROTL32(x12 + x8, 18);
-
-        x9 ^= ROTL32(x5 + x1, 7);
-        x13 ^= ROTL32(x9 + x5, 9);
-        x1 ^= ROTL32(x13 + x9, 13);
-        x5 ^= ROTL32(x1 + x13, 18);
-
-        x14 ^= ROTL32(x10 + x6, 7);
-        x2 ^= ROTL32(x14 + x10, 9);
-        x6 ^= ROTL32(x2 + x14, 13);
-        x10 ^= ROTL32(x6 + x2, 18);
-
-        x3 ^= ROTL32(x15 + x11, 7);
-        x7 ^= ROTL32(x3 + x15, 9);
-        x11 ^= ROTL32(x7 + x3, 13);
-        x15 ^= ROTL32(x11 + x7, 18);
-
-        // even round: diagonals
-        x1 ^= ROTL32(x0 + x3, 7);
-        x2 ^= ROTL32(x1 + x0, 9);
-        x3 ^= ROTL32(x2 + x1, 13);
-        x0 ^= ROTL32(x3 + x2, 18);
-
-        x6 ^= ROTL32(x5 + x4, 7);
-        x7 ^= ROTL32(x6 + x5, 9);
-        x4 ^= ROTL32(x7 + x6, 13);
-        x5 ^= ROTL32(x4 + x7, 18);
-
-        x11 ^= ROTL32(x10 + x9, 7);
-        x8  ^= ROTL32(x11 + x10, 9);
-        x9  ^= ROTL32(x8  + x11, 13);
-        x10 ^= ROTL32(x9  + x8, 18);
-
-        x12 ^= ROTL32(x15 + x14, 7);
-        x13 ^= ROTL32(x12 + x15, 9);
-        x14 ^= ROTL32(x13 + x12, 13);
-        x15 ^= ROTL32(x14 + x13, 18);
-    }
+    SALSA_ROUNDS(rounds);
 
     // add original input (feed‐forward) and serialize
     store32_le(out +  0, x0  + in[0]);
@@ -101,25 +112,15 @@ static void salsa20_core(uint8_t out[64], const uint32_t in[16]) {
 }
 
 /*
- * salsa20_xor(out, in, len, key, nonce, counter)
- *   High‐level API: XOR‐encrypt/decrypt `len` bytes of `in` into `out`
- *   using a 256‐bit key, 96‐bit nonce, and 32‐bit counter.
+ * salsa_init_state(state, key, nonce, counter)
+ *   Constants in words 0..3, key in 4..11, block counter in 12 and the
+ *   96-bit nonce in 13..15.
  */
-void salsa20_xor(uint8_t *out,
-                 const uint8_t *in,
-                 size_t len,
-                 const uint8_t key[32],
-                 const uint8_t nonce[12],
-                 uint32_t counter)
-{
-    uint32_t state[16];
-    uint8_t block[64];
-    size_t off = 0;
-
+static void salsa_init_state(uint32_t state[16], const uint8_t key[32],
+                             const uint8_t nonce[12], uint32_t counter) {
     // constants "expand 32-byte k"
     const uint8_t *cstr = (const uint8_t *)"expand 32-byte k";
 
-    // build initial state template
     state[0] = load32_le(cstr + 0);
     state[1] = load32_le(cstr + 4);
     state[2] = load32_le(cstr + 8);
@@ -128,22 +129,594 @@ void salsa20_xor(uint8_t *out,
     for (int i = 0; i < 8; i++) {
         state[4 + i] = load32_le(key + 4 * i);
     }
+    state[12] = counter;
     // set nonce words
     state[13] = load32_le(nonce + 0);
     state[14] = load32_le(nonce + 4);
     state[15] = load32_le(nonce + 8);
+}
+
+/*
+ * salsa_djb_init_state(state, key, nonce, counter)
+ *   Layout of Bernstein's Salsa20 spec, used by NaCl/libsodium: constants
+ *   on the diagonal (words 0, 5, 10, 15), key in 1..4 and 11..14, 64-bit
+ *   nonce in 6..7 and 64-bit block counter in 8..9, low word first.
+ */
+static void salsa_djb_init_state(uint32_t state[16], const uint8_t key[32],
+                                 const uint8_t nonce[8], uint64_t counter) {
+    const uint8_t *cstr = (const uint8_t *)"expand 32-byte k";
+
+    state[0]  = load32_le(cstr + 0);
+    state[5]  = load32_le(cstr + 4);
+    state[10] = load32_le(cstr + 8);
+    state[15] = load32_le(cstr + 12);
+    for (int i = 0; i < 4; i++) {
+        state[1 + i]  = load32_le(key + 4 * i);
+        state[11 + i] = load32_le(key + 16 + 4 * i);
+    }
+    state[6] = load32_le(nonce + 0);
+    state[7] = load32_le(nonce + 4);
+    state[8] = (uint32_t)counter;
+    state[9] = (uint32_t)(counter >> 32);
+}
+
+// Block counter word: 12 in this repo's layout, 8 (64-bit, with 9) in
+// Bernstein's
+#define SALSA_CTR_WORD(ctr64) ((ctr64) ? 8 : 12)
+
+/*
+ * salsa_ctr_add(state, n, ctr64)
+ *   Advance the block counter by n blocks (see arx_ctr_add).
+ */
+static inline void salsa_ctr_add(uint32_t state[16], uint32_t n, int ctr64) {
+    arx_ctr_add(state, SALSA_CTR_WORD(ctr64), n, ctr64);
+}
+
+/*
+ * salsa_blocks_scalar_tmpl(out, in, len, state, ctr64, rounds)
+ *   XOR `len` bytes one block at a time from an expanded state; the
+ *   counter is advanced past the blocks used (see salsa_ctr_add). Also the
+ *   tail of every SIMD kernel.
+ */
+static inline __attribute__((always_inline))
+void salsa_blocks_scalar_tmpl(uint8_t *out, const uint8_t *in, size_t len,
+                              uint32_t state[16], int ctr64, int rounds) {
+    uint8_t block[64];
+    size_t off = 0;
 
     while (len > 0) {
-        // set counter word
-        state[12] = counter++;
         // generate keystream block
-        salsa20_core(block, state);
+        salsa_core_tmpl(block, state, rounds);
+        salsa_ctr_add(state, 1, ctr64);
         // XOR up to 64 bytes
         size_t chunk = (len < 64 ? len : 64);
-        for (size_t i = 0; i < chunk; i++) {
-            out[off + i] = in[off + i] ^ block[i];
-        }
+        arx_xor_bytes(out + off, in + off, block, chunk);
         off += chunk;
         len -= chunk;
     }
-}
\ No newline at end of file
+}
+
+/*
+ * salsa_xor_tmpl(out, in, len, key, nonce, counter, rounds)
+ *   High‐level API: XOR‐encrypt/decrypt `len` bytes of `in` into `out`
+ *   using a 256‐bit key, 96‐bit nonce, and 32‐bit counter.
+ */
+static inline __attribute__((always_inline))
+void salsa_xor_tmpl(uint8_t *out,
+                    const uint8_t *in,
+                    size_t len,
+                    const uint8_t key[32],
+                    const uint8_t nonce[12],
+                    uint32_t counter,
+                    int rounds)
+{
+    uint32_t state[16];
+    salsa_init_state(state, key, nonce, counter);
+    salsa_blocks_scalar_tmpl(out, in, len, state, 0, rounds);
+}
+
+/*
+ * SALSA_DOUBLEROUND(QR, x)
+ *   One column round and one row round over the word vectors x[0..15]
+ *   (one Salsa word per vector, one block per lane). QR(a, b, c, d) is
+ *   the quarter round of salsa_core_tmpl in the kernel's vector type:
+ *     b ^= (a + d) <<< 7;  c ^= (b + a) <<< 9;
+ *     d ^= (c + b) <<< 13; a ^= (d + c) <<< 18;
+ */
+#define SALSA_DOUBLEROUND(QR, x)                                            \
+    do {                                                                    \
+        QR(x[0],  x[4],  x[8],  x[12]);                                     \
+        QR(x[5],  x[9],  x[13], x[1]);                                      \
+        QR(x[10], x[14], x[2],  x[6]);                                      \
+        QR(x[15], x[3],  x[7],  x[11]);                                     \
+        QR(x[0],  x[1],  x[2],  x[3]);                                      \
+        QR(x[5],  x[6],  x[7],  x[4]);                                      \
+        QR(x[10], x[11], x[8],  x[9]);                                      \
+        QR(x[15], x[12], x[13], x[14]);                                     \
+    } while (0)
+
+// SALSA_VQR(ADD, XOR, ROTL, a, b, c, d): the quarter round from the vector
+// add, xor and rotate-by-constant of one instruction set
+#define SALSA_VQR(ADD, XOR, ROTL, a, b, c, d)                               \
+    do {                                                                    \
+        b = XOR(b, ROTL(ADD(a, d), 7));                                     \
+        c = XOR(c, ROTL(ADD(b, a), 9));                                     \
+        d = XOR(d, ROTL(ADD(c, b), 13));                                    \
+        a = XOR(a, ROTL(ADD(d, c), 18));                                    \
+    } while (0)
+
+/*
+ * SALSA_KERNEL_VARIANTS(name, attr)
+ *   Salsa20/8, /12 and /20 instances of the kernel template
+ *   salsa_blocks_<name>_tmpl (attr carries its target attribute), plus
+ *   salsa_blocks_<name>, which picks one for a run-time round count.
+ */
+#define SALSA_KERNEL_VARIANTS(name, attr)                                       \
+    attr static void salsa_blocks_##name##_r8(uint8_t *out, const uint8_t *in,  \
+                                              size_t len, uint32_t state[16],   \
+                                              int ctr64) {                      \
+        salsa_blocks_##name##_tmpl(out, in, len, state, ctr64, 8);              \
+    }                                                                           \
+    attr static void salsa_blocks_##name##_r12(uint8_t *out, const uint8_t *in, \
+                                               size_t len, uint32_t state[16],  \
+                                               int ctr64) {                     \
+        salsa_blocks_##name##_tmpl(out, in, len, state, ctr64, 12);             \
+    }                                                                           \
+    attr static void salsa_blocks_##name##_r20(uint8_t *out, const uint8_t *in, \
+                                               size_t len, uint32_t state[16],  \
+                                               int ctr64) {                     \
+        salsa_blocks_##name##_tmpl(out, in, len, state, ctr64, 20);             \
+    }                                                                           \
+    static void salsa_blocks_##name(uint8_t *out, const uint8_t *in, size_t len, \
+                                    uint32_t state[16], int ctr64, int rounds) { \
+        switch (rounds) {                                                       \
+        case 8:  salsa_blocks_##name##_r8(out, in, len, state, ctr64);  break;  \
+        case 12: salsa_blocks_##name##_r12(out, in, len, state, ctr64); break;  \
+        default: salsa_blocks_##name##_r20(out, in, len, state, ctr64); break;  \
+        }                                                                       \
+    }
+
+SALSA_KERNEL_VARIANTS(scalar, )
+
+#if HAVE_NEON
+#define NEON_SALSA_QR(a, b, c, d) SALSA_VQR(vaddq_u32, veorq_u32, NEON_ROTL, a, b, c, d)
+
+// 4 blocks per pass, one Salsa word per uint32x4_t and one block per lane
+ARX_KERNEL(salsa_blocks_neon4, neon, uint32x4_t, 4, ,
+           SALSA_DOUBLEROUND, NEON_SALSA_QR, SALSA_CTR_WORD, salsa_blocks_scalar)
+SALSA_KERNEL_VARIANTS(neon4, )
+
+// NEON 4-way Salsa20, one-shot API
+void salsa20_xor_neon4(uint8_t *out, const uint8_t *in, size_t len,
+                       const uint8_t key[32], const uint8_t nonce[12],
+                       uint32_t counter) {
+    uint32_t state[16];
+    salsa_init_state(state, key, nonce, counter);
+    salsa_blocks_neon4(out, in, len, state, 0, 20);
+}
+#endif
+
+#if HAVE_X86
+// Salsa rotates by 7, 9, 13 and 18: none is a whole number of bytes, so
+// SSE2/AVX2 use the shift/or pair throughout and pshufb buys nothing.
+// AVX-512F has vprold for all four.
+#define SSE_SALSA_QR(a, b, c, d)    SALSA_VQR(_mm_add_epi32, _mm_xor_si128, SSE_ROTL, a, b, c, d)
+#define AVX2_SALSA_QR(a, b, c, d)   SALSA_VQR(_mm256_add_epi32, _mm256_xor_si256, AVX2_ROTL, a, b, c, d)
+#define AVX512_SALSA_QR(a, b, c, d) SALSA_VQR(_mm512_add_epi32, _mm512_xor_si512, AVX512_ROTL, a, b, c, d)
+
+// 4 blocks per pass in __m128i; plain SSE2, so it runs on every x86_64
+ARX_KERNEL(salsa_blocks_sse, sse, __m128i, 4, __attribute__((target("sse2"))),
+           SALSA_DOUBLEROUND, SSE_SALSA_QR, SALSA_CTR_WORD, salsa_blocks_scalar)
+SALSA_KERNEL_VARIANTS(sse, __attribute__((target("sse2"))))
+
+// 8 blocks per pass in __m256i
+ARX_KERNEL(salsa_blocks_avx2, avx2, __m256i, 8, __attribute__((target("avx2"))),
+           SALSA_DOUBLEROUND, AVX2_SALSA_QR, SALSA_CTR_WORD, salsa_blocks_sse)
+SALSA_KERNEL_VARIANTS(avx2, __attribute__((target("avx2"))))
+
+// 16 blocks per pass in __m512i, each vector one whole block after the
+// transposes
+ARX_KERNEL(salsa_blocks_avx512, avx512, __m512i, 16, __attribute__((target("avx512f"))),
+           SALSA_DOUBLEROUND, AVX512_SALSA_QR, SALSA_CTR_WORD, salsa_blocks_avx2)
+SALSA_KERNEL_VARIANTS(avx512, __attribute__((target("avx512f"))))
+
+// One-shot APIs; only call these on CPUs with the instruction set
+void salsa20_xor_sse2(uint8_t *out, const uint8_t *in, size_t len,
+                      const uint8_t key[32], const uint8_t nonce[12],
+                      uint32_t counter) {
+    uint32_t state[16];
+    salsa_init_state(state, key, nonce, counter);
+    salsa_blocks_sse(out, in, len, state, 0, 20);
+}
+
+void salsa20_xor_avx2(uint8_t *out, const uint8_t *in, size_t len,
+                      const uint8_t key[32], const uint8_t nonce[12],
+                      uint32_t counter) {
+    uint32_t state[16];
+    salsa_init_state(state, key, nonce, counter);
+    salsa_blocks_avx2(out, in, len, state, 0, 20);
+}
+
+void salsa20_xor_avx512(uint8_t *out, const uint8_t *in, size_t len,
+                        const uint8_t key[32], const uint8_t nonce[12],
+                        uint32_t counter) {
+    uint32_t state[16];
+    salsa_init_state(state, key, nonce, counter);
+    salsa_blocks_avx512(out, in, len, state, 0, 20);
+}
+
+enum { SALSA_X86_SSE2 = 0, SALSA_X86_AVX2, SALSA_X86_AVX512 };
+
+// Shortest message handed to the AVX-512 kernel, for the same reason as
+// CHACHA20_AVX512_MIN_LEN: shorter ones do not pay for the clock drop.
+#ifndef SALSA20_AVX512_MIN_LEN
+#define SALSA20_AVX512_MIN_LEN 16384
+#endif
+
+static int salsa_x86_level(void) {
+    static int level = -1;
+    if (level < 0) {
+        int l = SALSA_X86_SSE2;
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) l = SALSA_X86_AVX2;
+        if (l == SALSA_X86_AVX2 && __builtin_cpu_supports("avx512f"))
+            l = SALSA_X86_AVX512;
+        level = l;
+    }
+    return level;
+}
+#endif
+
+/*
+ * salsa_blocks_best(out, in, len, state, ctr64, rounds)
+ *   Runtime dispatch: NEON 4-way on ARM; on x86 AVX-512 16-way (from
+ *   SALSA20_AVX512_MIN_LEN bytes), AVX2 8-way or SSE2 4-way; scalar
+ *   elsewhere. Messages shorter than one pass of the chosen kernel fall
+ *   through its tail path, so short inputs cost no more than the scalar code.
+ */
+static void salsa_blocks_best(uint8_t *out, const uint8_t *in, size_t len,
+                              uint32_t state[16], int ctr64, int rounds) {
+#if HAVE_NEON
+    salsa_blocks_neon4(out, in, len, state, ctr64, rounds);
+#elif HAVE_X86
+    switch (salsa_x86_level()) {
+    case SALSA_X86_AVX512:
+        if (len >= SALSA20_AVX512_MIN_LEN) {
+            salsa_blocks_avx512(out, in, len, state, ctr64, rounds);
+            break;
+        }
+        // fall through
+    case SALSA_X86_AVX2:
+        salsa_blocks_avx2(out, in, len, state, ctr64, rounds);
+        break;
+    default:
+        salsa_blocks_sse(out, in, len, state, ctr64, rounds);
+        break;
+    }
+#else
+    salsa_blocks_scalar(out, in, len, state, ctr64, rounds);
+#endif
+}
+
+/*
+ * SALSA_DEFINE_VARIANT(R)
+ *   Instantiate the fixed-round core salsaR_core and the stream functions
+ *   salsaR_xor (one block at a time) and salsaR_xor_best (SIMD dispatch,
+ *   same output) from the templates above.
+ */
+#define SALSA_DEFINE_VARIANT(R)                                             \
+    static __attribute__((unused))                                          \
+    void salsa##R##_core(uint8_t out[64], const uint32_t in[16]) {          \
+        salsa_core_tmpl(out, in, R);                                        \
+    }                                                                       \
+    void salsa##R##_xor(uint8_t *out, const uint8_t *in, size_t len,        \
+                        const uint8_t key[32], const uint8_t nonce[12],     \
+                        uint32_t counter) {                                 \
+        salsa_xor_tmpl(out, in, len, key, nonce, counter, R);               \
+    }                                                                       \
+    void salsa##R##_xor_best(uint8_t *out, const uint8_t *in, size_t len,   \
+                             const uint8_t key[32], const uint8_t nonce[12], \
+                             uint32_t counter) {                            \
+        uint32_t state[16];                                                 \
+        salsa_init_state(state, key, nonce, counter);                       \
+        salsa_blocks_best(out, in, len, state, 0, R);                          \
+    }
+
+SALSA_DEFINE_VARIANT(20)
+SALSA_DEFINE_VARIANT(12)
+SALSA_DEFINE_VARIANT(8)
+
+/*
+ * salsa20_djb_xor(out, in, len, key, nonce, counter)
+ *   Salsa20 in the layout of Bernstein's spec (64-bit nonce, 64-bit block
+ *   counter), as NaCl/libsodium crypto_stream_salsa20_xor_ic. Same SIMD
+ *   dispatch as salsa20_xor_best.
+ */
+void salsa20_djb_xor(uint8_t *out, const uint8_t *in, size_t len,
+                     const uint8_t key[32], const uint8_t nonce[8],
+                     uint64_t counter) {
+    uint32_t state[16];
+    salsa_djb_init_state(state, key, nonce, counter);
+    salsa_blocks_best(out, in, len, state, 1, 20);
+}
+
+/*
+ * hsalsa20(subkey, key, nonce)
+ *   HSalsa20 (XSalsa20 paper): the Bernstein-layout state with the 16-byte
+ *   nonce in words 6..9, run through the 20 rounds of salsa20_core but
+ *   without the feed-forward; words 0, 5, 10, 15 and 6..9 form the
+ *   256-bit subkey.
+ */
+void hsalsa20(uint8_t subkey[32], const uint8_t key[32], const uint8_t nonce[16]) {
+    uint32_t x0 = 0x61707865, x5 = 0x3320646e, x10 = 0x79622d32, x15 = 0x6b206574;
+    uint32_t x1 = load32_le(key + 0),   x2 = load32_le(key + 4);
+    uint32_t x3 = load32_le(key + 8),   x4 = load32_le(key + 12);
+    uint32_t x11 = load32_le(key + 16), x12 = load32_le(key + 20);
+    uint32_t x13 = load32_le(key + 24), x14 = load32_le(key + 28);
+    uint32_t x6 = load32_le(nonce + 0), x7 = load32_le(nonce + 4);
+    uint32_t x8 = load32_le(nonce + 8), x9 = load32_le(nonce + 12);
+
+    SALSA_ROUNDS(20);
+
+    store32_le(subkey +  0, x0);
+    store32_le(subkey +  4, x5);
+    store32_le(subkey +  8, x10);
+    store32_le(subkey + 12, x15);
+    store32_le(subkey + 16, x6);
+    store32_le(subkey + 20, x7);
+    store32_le(subkey + 24, x8);
+    store32_le(subkey + 28, x9);
+}
+
+/*
+ * xsalsa20_xor(out, in, len, key, nonce, counter)
+ *   XSalsa20 with a 192-bit nonce, safe to pick at random: the first 16
+ *   nonce bytes derive a subkey through hsalsa20, the last 8 are the
+ *   Salsa20 nonce, and the payload goes through salsa20_djb_xor.
+ */
+void xsalsa20_xor(uint8_t *out, const uint8_t *in, size_t len,
+                  const uint8_t key[32], const uint8_t nonce[24],
+                  uint64_t counter) {
+    uint8_t subkey[32];
+    hsalsa20(subkey, key, nonce);
+    salsa20_djb_xor(out, in, len, subkey, nonce + 16, counter);
+    arx_wipe(subkey, sizeof(subkey));
+}
+
+/*
+ * salsa_core_words_tmpl(x, rounds)
+ *   salsa_core_tmpl on a block of words in host order, in place: x =
+ *   x + `rounds` rounds of x. No byte order conversion, for constructions
+ *   that chain the core on their own buffers (scrypt's BlockMix).
+ */
+static inline __attribute__((always_inline))
+void salsa_core_words_tmpl(uint32_t x[16], int rounds) {
+    uint32_t x0 = x[0],  x1 = x[1],  x2 = x[2],  x3 = x[3];
+    uint32_t x4 = x[4],  x5 = x[5],  x6 = x[6],  x7 = x[7];
+    uint32_t x8 = x[8],  x9 = x[9],  x10 = x[10], x11 = x[11];
+    uint32_t x12 = x[12], x13 = x[13], x14 = x[14], x15 = x[15];
+
+    SALSA_ROUNDS(rounds);
+
+    x[0]  += x0;  x[1]  += x1;  x[2]  += x2;  x[3]  += x3;
+    x[4]  += x4;  x[5]  += x5;  x[6]  += x6;  x[7]  += x7;
+    x[8]  += x8;  x[9]  += x9;  x[10] += x10; x[11] += x11;
+    x[12] += x12; x[13] += x13; x[14] += x14; x[15] += x15;
+}
+
+void salsa_core(uint32_t x[16], int rounds) {
+    switch (rounds) {
+    case 8:  salsa_core_words_tmpl(x, 8);  break;
+    case 12: salsa_core_words_tmpl(x, 12); break;
+    default: salsa_core_words_tmpl(x, 20); break;
+    }
+}
+
+/*
+ * Multi-lane word cores
+ *   salsa_lanes_<isa>_tmpl(b, rounds) runs salsa_core on the blocks
+ *   b[0..W-1] at once, W being the lanes of the vector type. The blocks
+ *   are loaded as rows and turned into word vectors with the transposes
+ *   of arx_simd.h (each is its own inverse), run through the rounds of the
+ *   stream kernels, and transposed back. Words are little-endian on every
+ *   target these are built for, so a block of words is also its bytes.
+ *
+ * SALSA_LANES_VARIANTS(name, attr)
+ *   Salsa20/8, /12 and /20 instances of salsa_lanes_<name>_tmpl, plus
+ *   salsa_lanes_<name>, which picks one for a run-time round count.
+ */
+#define SALSA_LANES_VARIANTS(name, attr)                                    \
+    attr static void salsa_lanes_##name##_r8(uint32_t *const b[]) {         \
+        salsa_lanes_##name##_tmpl(b, 8);                                    \
+    }                                                                       \
+    attr static void salsa_lanes_##name##_r12(uint32_t *const b[]) {        \
+        salsa_lanes_##name##_tmpl(b, 12);                                   \
+    }                                                                       \
+    attr static void salsa_lanes_##name##_r20(uint32_t *const b[]) {        \
+        salsa_lanes_##name##_tmpl(b, 20);                                   \
+    }                                                                       \
+    static void salsa_lanes_##name(uint32_t *const b[], int rounds) {       \
+        switch (rounds) {                                                   \
+        case 8:  salsa_lanes_##name##_r8(b);  break;                        \
+        case 12: salsa_lanes_##name##_r12(b); break;                        \
+        default: salsa_lanes_##name##_r20(b); break;                        \
+        }                                                                   \
+    }
+
+#if HAVE_NEON
+static inline __attribute__((always_inline))
+void salsa_lanes_neon_tmpl(uint32_t *const b[], int rounds) {
+    uint32x4_t x[16], s[16];
+    // x[g+k] = words g..g+3 of block k, then word vectors
+    for (int g = 0; g < 16; g += 4) {
+        for (int k = 0; k < 4; k++) {
+            x[g + k] = vld1q_u32(b[k] + g);
+        }
+        NEON_TRANSPOSE4(x[g], x[g + 1], x[g + 2], x[g + 3]);
+    }
+    for (int w = 0; w < 16; w++) {
+        s[w] = x[w];
+    }
+    ARX_UNROLL
+    for (int i = 0; i < rounds; i += 2) {
+        SALSA_DOUBLEROUND(NEON_SALSA_QR, x);
+    }
+    for (int g = 0; g < 16; g += 4) {
+        for (int k = 0; k < 4; k++) {
+            x[g + k] = vaddq_u32(x[g + k], s[g + k]);
+        }
+        NEON_TRANSPOSE4(x[g], x[g + 1], x[g + 2], x[g + 3]);
+        for (int k = 0; k < 4; k++) {
+            vst1q_u32(b[k] + g, x[g + k]);
+        }
+    }
+}
+SALSA_LANES_VARIANTS(neon, )
+#endif
+
+#if HAVE_X86
+static inline __attribute__((target("sse2"), always_inline))
+void salsa_lanes_sse_tmpl(uint32_t *const b[], int rounds) {
+    __m128i x[16], s[16];
+    // x[g+k] = words g..g+3 of block k, then word vectors
+    for (int g = 0; g < 16; g += 4) {
+        for (int k = 0; k < 4; k++) {
+            x[g + k] = _mm_loadu_si128((const __m128i *)(b[k] + g));
+        }
+        SSE_TRANSPOSE4(x[g], x[g + 1], x[g + 2], x[g + 3]);
+    }
+    for (int w = 0; w < 16; w++) {
+        s[w] = x[w];
+    }
+    ARX_UNROLL
+    for (int i = 0; i < rounds; i += 2) {
+        SALSA_DOUBLEROUND(SSE_SALSA_QR, x);
+    }
+    for (int g = 0; g < 16; g += 4) {
+        for (int k = 0; k < 4; k++) {
+            x[g + k] = _mm_add_epi32(x[g + k], s[g + k]);
+        }
+        SSE_TRANSPOSE4(x[g], x[g + 1], x[g + 2], x[g + 3]);
+        for (int k = 0; k < 4; k++) {
+            _mm_storeu_si128((__m128i *)(b[k] + g), x[g + k]);
+        }
+    }
+}
+SALSA_LANES_VARIANTS(sse, __attribute__((target("sse2"))))
+
+static inline __attribute__((target("avx2"), always_inline))
+void salsa_lanes_avx2_tmpl(uint32_t *const b[], int rounds) {
+    __m256i x[16], s[16];
+    // x[g+k] = words g..g+3 of block k (low half) and block k+4 (high half)
+    for (int g = 0; g < 16; g += 4) {
+        for (int k = 0; k < 4; k++) {
+            __m128i lo = _mm_loadu_si128((const __m128i *)(b[k] + g));
+            __m128i hi = _mm_loadu_si128((const __m128i *)(b[k + 4] + g));
+            x[g + k] = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+        }
+        AVX2_TRANSPOSE4(x[g], x[g + 1], x[g + 2], x[g + 3]);
+    }
+    for (int w = 0; w < 16; w++) {
+        s[w] = x[w];
+    }
+    ARX_UNROLL
+    for (int i = 0; i < rounds; i += 2) {
+        SALSA_DOUBLEROUND(AVX2_SALSA_QR, x);
+    }
+    for (int g = 0; g < 16; g += 4) {
+        for (int k = 0; k < 4; k++) {
+            x[g + k] = _mm256_add_epi32(x[g + k], s[g + k]);
+        }
+        AVX2_TRANSPOSE4(x[g], x[g + 1], x[g + 2], x[g + 3]);
+        for (int k = 0; k < 4; k++) {
+            _mm_storeu_si128((__m128i *)(b[k] + g), _mm256_castsi256_si128(x[g + k]));
+            _mm_storeu_si128((__m128i *)(b[k + 4] + g), _mm256_extracti128_si256(x[g + k], 1));
+        }
+    }
+}
+SALSA_LANES_VARIANTS(avx2, __attribute__((target("avx2"))))
+
+// The inverse of arx_avx512_xor_out's transposes: 128-bit lanes across
+// vectors first, then words within each lane
+static inline __attribute__((target("avx512f"), always_inline))
+void salsa_lanes_avx512_tmpl(uint32_t *const b[], int rounds) {
+    __m512i x[16], s[16];
+    for (int k = 0; k < 16; k++) {
+        x[k] = _mm512_loadu_si512((const void *)b[k]);
+    }
+    for (int k = 0; k < 4; k++) {
+        AVX512_TRANSPOSE128(x[k], x[4 + k], x[8 + k], x[12 + k]);
+    }
+    for (int g = 0; g < 16; g += 4) {
+        AVX512_TRANSPOSE4(x[g], x[g + 1], x[g + 2], x[g + 3]);
+    }
+    for (int w = 0; w < 16; w++) {
+        s[w] = x[w];
+    }
+    ARX_UNROLL
+    for (int i = 0; i < rounds; i += 2) {
+        SALSA_DOUBLEROUND(AVX512_SALSA_QR, x);
+    }
+    for (int w = 0; w < 16; w++) {
+        x[w] = _mm512_add_epi32(x[w], s[w]);
+    }
+    for (int g = 0; g < 16; g += 4) {
+        AVX512_TRANSPOSE4(x[g], x[g + 1], x[g + 2], x[g + 3]);
+    }
+    for (int k = 0; k < 4; k++) {
+        AVX512_TRANSPOSE128(x[k], x[4 + k], x[8 + k], x[12 + k]);
+    }
+    for (int k = 0; k < 16; k++) {
+        _mm512_storeu_si512((void *)b[k], x[k]);
+    }
+}
+SALSA_LANES_VARIANTS(avx512, __attribute__((target("avx512f"))))
+#endif
+
+/*
+ * salsa_core_lanes(b, lanes, rounds)
+ *   salsa_core on each of b[0..lanes-1]: groups of 16 (AVX-512), 8 (AVX2)
+ *   or 4 (SSE2, NEON) blocks go through the multi-lane cores, the rest
+ *   one at a time. No minimum length for AVX-512: callers run the core
+ *   millions of times in a row.
+ */
+void salsa_core_lanes(uint32_t *const b[], size_t lanes, int rounds) {
+    size_t l = 0;
+#if HAVE_NEON
+    for (; lanes - l >= 4; l += 4) {
+        salsa_lanes_neon(b + l, rounds);
+    }
+#elif HAVE_X86
+    int level = salsa_x86_level();
+    if (level == SALSA_X86_AVX512) {
+        for (; lanes - l >= 16; l += 16) {
+            salsa_lanes_avx512(b + l, rounds);
+        }
+    }
+    if (level >= SALSA_X86_AVX2) {
+        for (; lanes - l >= 8; l += 8) {
+            salsa_lanes_avx2(b + l, rounds);
+        }
+    }
+    for (; lanes - l >= 4; l += 4) {
+        salsa_lanes_sse(b + l, rounds);
+    }
+#endif
+    for (; l < lanes; l++) {
+        salsa_core(b[l], rounds);
+    }
+}
+
+size_t salsa_core_lanes_max(void) {
+#if HAVE_NEON
+    return 4;
+#elif HAVE_X86
+    switch (salsa_x86_level()) {
+    case SALSA_X86_AVX512: return 16;
+    case SALSA_X86_AVX2:   return 8;
+    default:               return 4;
+    }
+#else
+    return 1;
+#endif
+}
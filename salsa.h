@@ -0,0 +1,71 @@
+// salsa.h
+// Public interface of salsa.c. Unless noted: key 32 bytes, nonce 12 bytes,
+// 32-bit block counter in word 12 (this repo's layout, not Bernstein's).
+
+#ifndef SALSA_H
+#define SALSA_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// One block at a time, portable
+void salsa20_xor(uint8_t *out, const uint8_t *in, size_t len,
+                 const uint8_t key[32], const uint8_t nonce[12],
+                 uint32_t counter);
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+void salsa20_xor_neon4(uint8_t *out, const uint8_t *in, size_t len,
+                       const uint8_t key[32], const uint8_t nonce[12],
+                       uint32_t counter);
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+// Only call these directly on CPUs that support the instruction set
+void salsa20_xor_sse2(uint8_t *out, const uint8_t *in, size_t len,
+                      const uint8_t key[32], const uint8_t nonce[12],
+                      uint32_t counter);
+void salsa20_xor_avx2(uint8_t *out, const uint8_t *in, size_t len,
+                      const uint8_t key[32], const uint8_t nonce[12],
+                      uint32_t counter);
+void salsa20_xor_avx512(uint8_t *out, const uint8_t *in, size_t len,
+                        const uint8_t key[32], const uint8_t nonce[12],
+                        uint32_t counter);
+#endif
+// Widest SIMD kernel the CPU has; same output as salsa20_xor
+void salsa20_xor_best(uint8_t *out, const uint8_t *in, size_t len,
+                      const uint8_t key[32], const uint8_t nonce[12],
+                      uint32_t counter);
+
+// Reduced-round Salsa20/12 and Salsa20/8, same layout
+void salsa12_xor(uint8_t *out, const uint8_t *in, size_t len,
+                 const uint8_t key[32], const uint8_t nonce[12],
+                 uint32_t counter);
+void salsa12_xor_best(uint8_t *out, const uint8_t *in, size_t len,
+                      const uint8_t key[32], const uint8_t nonce[12],
+                      uint32_t counter);
+void salsa8_xor(uint8_t *out, const uint8_t *in, size_t len,
+                const uint8_t key[32], const uint8_t nonce[12],
+                uint32_t counter);
+void salsa8_xor_best(uint8_t *out, const uint8_t *in, size_t len,
+                     const uint8_t key[32], const uint8_t nonce[12],
+                     uint32_t counter);
+
+// Bernstein's layout as used by NaCl/libsodium: 64-bit nonce, 64-bit block
+// counter (crypto_stream_salsa20_xor_ic)
+void salsa20_djb_xor(uint8_t *out, const uint8_t *in, size_t len,
+                     const uint8_t key[32], const uint8_t nonce[8],
+                     uint64_t counter);
+
+// XSalsa20: HSalsa20 subkey derivation and 192-bit nonce encryption
+void hsalsa20(uint8_t subkey[32], const uint8_t key[32], const uint8_t nonce[16]);
+void xsalsa20_xor(uint8_t *out, const uint8_t *in, size_t len,
+                  const uint8_t key[32], const uint8_t nonce[24],
+                  uint64_t counter);
+
+// The core on one 16-word block in host order, in place: x += rounds(x).
+// rounds is 8, 12 or 20 (Salsa20/8 is scrypt's BlockMix function).
+void salsa_core(uint32_t x[16], int rounds);
+// salsa_core on each of the independent blocks b[0..lanes-1], several at
+// a time in SIMD lanes; salsa_core_lanes_max() is the widest group
+void salsa_core_lanes(uint32_t *const b[], size_t lanes, int rounds);
+size_t salsa_core_lanes_max(void);
+
+#endif
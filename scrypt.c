@@ -0,0 +1,552 @@
+// scrypt.c
+// scrypt (RFC 7914): PBKDF2-HMAC-SHA256 spreads the password over p lanes
+// of 128*r bytes, each lane goes through ROMix (N BlockMix steps filling
+// V, N more reading it back in data-dependent order), and a second
+// PBKDF2 pass condenses the lanes into the key. BlockMix chains the
+// Salsa20/8 core, salsa_core(x, 8) of salsa.c.
+//
+// - Memory: a context owns one arena holding the PBKDF2 output and the
+//   V/X/Y buffers of every lane in flight. It only grows, so a login
+//   server hashing with fixed parameters allocates once. Each lane's
+//   scratch is wiped as soon as its group is done, and B at the end of
+//   the hash, so no password-derived state stays behind between calls.
+// - Threads: the p lanes are independent. A persistent pool (the caller
+//   works as well) claims groups of lanes from a shared atomic index.
+// - SIMD: a group of up to salsa_core_lanes_max() lanes (16 on AVX-512,
+//   8 on AVX2, 4 on SSE2/NEON) runs ROMix in lockstep, so every Salsa20/8
+//   call of BlockMix goes through salsa_core_lanes, one lane per vector
+//   element. Lanes are spread over the threads first and only stacked
+//   into groups when p exceeds the thread count; with p = 1 the hash runs
+//   the scalar core on one thread, as scrypt intends.
+//
+// Build: gcc -O3 -std=c11 -pthread -c scrypt.c salsa.c
+
+#include <errno.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "scrypt.h"
+#include "salsa.h"
+#include "arx_simd.h"   // ROTR32, load32_le / store32_le, arx_wipe
+
+#define SCRYPT_SALSA_ROUNDS 8       // BlockMix uses Salsa20/8
+#define SCRYPT_MAX_LANES    16      // widest salsa_core_lanes group
+#define SCRYPT_MAX_THREADS  256
+
+// SHA-256, HMAC and one-iteration PBKDF2: all scrypt needs around ROMix
+
+typedef struct {
+    uint32_t h[8];
+    uint64_t len;           // bytes hashed so far
+    uint8_t  buf[64];
+    size_t   buf_len;
+} sha256_ctx;
+
+static const uint32_t sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static inline uint32_t load32_be(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16)
+         | ((uint32_t)p[2] << 8)  |  (uint32_t)p[3];
+}
+
+static inline void store32_be(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+static void sha256_init(sha256_ctx *s) {
+    static const uint32_t iv[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+    };
+    memcpy(s->h, iv, sizeof(iv));
+    s->len = 0;
+    s->buf_len = 0;
+}
+
+static void sha256_block(uint32_t h[8], const uint8_t p[64]) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++) {
+        w[i] = load32_be(p + 4 * i);
+    }
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = ROTR32(w[i-15], 7) ^ ROTR32(w[i-15], 18) ^ (w[i-15] >> 3);
+        uint32_t s1 = ROTR32(w[i-2], 17) ^ ROTR32(w[i-2], 19) ^ (w[i-2] >> 10);
+        w[i] = w[i-16] + s0 + w[i-7] + s1;
+    }
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3];
+    uint32_t e = h[4], f = h[5], g = h[6], k = h[7];
+    for (int i = 0; i < 64; i++) {
+        uint32_t S1 = ROTR32(e, 6) ^ ROTR32(e, 11) ^ ROTR32(e, 25);
+        uint32_t t1 = k + S1 + ((e & f) ^ (~e & g)) + sha256_k[i] + w[i];
+        uint32_t S0 = ROTR32(a, 2) ^ ROTR32(a, 13) ^ ROTR32(a, 22);
+        uint32_t t2 = S0 + ((a & b) ^ (a & c) ^ (b & c));
+        k = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+    h[0] += a; h[1] += b; h[2] += c; h[3] += d;
+    h[4] += e; h[5] += f; h[6] += g; h[7] += k;
+}
+
+static void sha256_update(sha256_ctx *s, const uint8_t *in, size_t len) {
+    s->len += len;
+    if (s->buf_len > 0) {
+        size_t n = 64 - s->buf_len < len ? 64 - s->buf_len : len;
+        memcpy(s->buf + s->buf_len, in, n);
+        s->buf_len += n;
+        in += n;
+        len -= n;
+        if (s->buf_len < 64) return;
+        sha256_block(s->h, s->buf);
+        s->buf_len = 0;
+    }
+    for (; len >= 64; in += 64, len -= 64) {
+        sha256_block(s->h, in);
+    }
+    memcpy(s->buf, in, len);
+    s->buf_len = len;
+}
+
+static void sha256_final(sha256_ctx *s, uint8_t out[32]) {
+    uint64_t bits = s->len * 8;
+    uint8_t pad[72] = { 0x80 };
+    size_t n = (s->buf_len < 56 ? 56 : 120) - s->buf_len;
+    store32_be(pad + n, (uint32_t)(bits >> 32));
+    store32_be(pad + n + 4, (uint32_t)bits);
+    sha256_update(s, pad, n + 8);
+    for (int i = 0; i < 8; i++) {
+        store32_be(out + 4 * i, s->h[i]);
+    }
+}
+
+// HMAC-SHA256 with the key absorbed once: inner and outer hold the states
+// after the ipad and opad blocks and are copied for every message
+typedef struct {
+    sha256_ctx inner, outer;
+} hmac_sha256_key;
+
+static void hmac_sha256_init(hmac_sha256_key *hk, const uint8_t *key, size_t key_len) {
+    uint8_t k[64] = { 0 }, pad[64];
+    if (key_len > 64) {
+        sha256_ctx s;
+        sha256_init(&s);
+        sha256_update(&s, key, key_len);
+        sha256_final(&s, k);
+    } else if (key_len > 0) {
+        memcpy(k, key, key_len);
+    }
+    for (int i = 0; i < 64; i++) pad[i] = k[i] ^ 0x36;
+    sha256_init(&hk->inner);
+    sha256_update(&hk->inner, pad, 64);
+    for (int i = 0; i < 64; i++) pad[i] = k[i] ^ 0x5c;
+    sha256_init(&hk->outer);
+    sha256_update(&hk->outer, pad, 64);
+}
+
+// PBKDF2-HMAC-SHA256 with one iteration (RFC 8018): block i of the
+// output is HMAC(password, salt || i), i counting from 1, big-endian
+static void pbkdf2_sha256_1(const hmac_sha256_key *hk, const uint8_t *salt,
+                            size_t salt_len, uint8_t *out, size_t out_len) {
+    for (uint32_t i = 1; out_len > 0; i++) {
+        uint8_t ctr[4], u[32];
+        store32_be(ctr, i);
+        sha256_ctx s = hk->inner;
+        sha256_update(&s, salt, salt_len);
+        sha256_update(&s, ctr, 4);
+        sha256_final(&s, u);
+        s = hk->outer;
+        sha256_update(&s, u, 32);
+        sha256_final(&s, u);
+        size_t n = out_len < 32 ? out_len : 32;
+        memcpy(out, u, n);
+        out += n;
+        out_len -= n;
+    }
+}
+
+// BlockMix and ROMix over a group of lanes
+
+/*
+ * scrypt_blockmix_lanes(out, in, in2, lanes, r)
+ *   BlockMix_{Salsa20/8, r} of in[l] ^ in2[l] (in2 may be NULL) into
+ *   out[l] for each lane, blocks of 32*r words in host order. Y_i is
+ *   written straight to its shuffled place in out (even i to the first
+ *   half, odd i to the second) and serves as the next X, so there is no
+ *   copy. All lanes take step i together: one salsa_core_lanes call.
+ */
+static void scrypt_blockmix_lanes(uint32_t *const out[], uint32_t *const in[],
+                                  const uint32_t *const in2[], size_t lanes,
+                                  uint32_t r) {
+    uint32_t *y[SCRYPT_MAX_LANES];
+    const uint32_t *prev[SCRYPT_MAX_LANES];
+    size_t last = (size_t)(2 * r - 1) * 16;
+
+    for (size_t i = 0; i < 2 * (size_t)r; i++) {
+        for (size_t l = 0; l < lanes; l++) {
+            uint32_t *d = out[l] + ((i >> 1) + (i & 1) * r) * 16;
+            const uint32_t *b = in[l] + i * 16;
+            if (in2 != NULL) {
+                const uint32_t *b2 = in2[l] + i * 16;
+                if (i == 0) {
+                    // X = B[2r-1] ^ B[0], both taken from in ^ in2
+                    for (int k = 0; k < 16; k++) {
+                        d[k] = in[l][last + k] ^ in2[l][last + k] ^ b[k] ^ b2[k];
+                    }
+                } else {
+                    for (int k = 0; k < 16; k++) {
+                        d[k] = prev[l][k] ^ b[k] ^ b2[k];
+                    }
+                }
+            } else {
+                const uint32_t *x = (i == 0) ? in[l] + last : prev[l];
+                for (int k = 0; k < 16; k++) {
+                    d[k] = x[k] ^ b[k];
+                }
+            }
+            y[l] = d;
+        }
+        salsa_core_lanes(y, lanes, SCRYPT_SALSA_ROUNDS);
+        for (size_t l = 0; l < lanes; l++) {
+            prev[l] = y[l];
+        }
+    }
+}
+
+// Integerify: the first 64-bit little-endian word of the last 64-byte
+// block, reduced mod N (a power of two)
+static inline uint64_t scrypt_integerify(const uint32_t *x, uint32_t r, uint64_t N) {
+    const uint32_t *b = x + (size_t)(2 * r - 1) * 16;
+    return (((uint64_t)b[1] << 32) | b[0]) & (N - 1);
+}
+
+/*
+ * scrypt_romix_lanes(B, lanes, N, r, mem)
+ *   ROMix in place on `lanes` consecutive lanes of 128*r bytes at B.
+ *   mem holds 32*r*(N+2) words per lane: V[0..N-1], then X and Y. V[0]
+ *   is the lane itself and BlockMix(V[i]) is written straight to V[i+1];
+ *   the second loop ping-pongs between X and Y.
+ */
+static void scrypt_romix_lanes(uint8_t *B, size_t lanes, uint64_t N,
+                               uint32_t r, uint32_t *mem) {
+    size_t bw = (size_t)32 * r;     // words per 128*r-byte block
+    uint32_t *V[SCRYPT_MAX_LANES], *X[SCRYPT_MAX_LANES], *Y[SCRYPT_MAX_LANES];
+    uint32_t *src[SCRYPT_MAX_LANES], *dst[SCRYPT_MAX_LANES];
+    const uint32_t *Vj[SCRYPT_MAX_LANES] = { 0 };
+
+    for (size_t l = 0; l < lanes; l++) {
+        V[l] = mem + l * bw * (size_t)(N + 2);
+        X[l] = V[l] + bw * (size_t)N;
+        Y[l] = X[l] + bw;
+        const uint8_t *b = B + l * 4 * bw;
+        for (size_t k = 0; k < bw; k++) {
+            V[l][k] = load32_le(b + 4 * k);
+        }
+    }
+
+    for (uint64_t i = 0; i < N; i++) {
+        for (size_t l = 0; l < lanes; l++) {
+            src[l] = V[l] + (size_t)i * bw;
+            dst[l] = (i + 1 < N) ? src[l] + bw : X[l];
+        }
+        scrypt_blockmix_lanes(dst, src, NULL, lanes, r);
+    }
+
+    for (uint64_t i = 0; i < N; i++) {
+        for (size_t l = 0; l < lanes; l++) {
+            Vj[l] = V[l] + (size_t)scrypt_integerify(X[l], r, N) * bw;
+        }
+        scrypt_blockmix_lanes(Y, X, Vj, lanes, r);
+        for (size_t l = 0; l < lanes; l++) {
+            uint32_t *t = X[l];
+            X[l] = Y[l];
+            Y[l] = t;
+        }
+    }
+
+    for (size_t l = 0; l < lanes; l++) {
+        uint8_t *b = B + l * 4 * bw;
+        for (size_t k = 0; k < bw; k++) {
+            store32_le(b + 4 * k, X[l][k]);
+        }
+    }
+}
+
+// Context: arena and worker pool
+
+// One hash, read-only except for the group cursor
+typedef struct {
+    uint8_t *B;             // p lanes of 128*r bytes
+    uint8_t *slots;         // workers' scratch, slot_bytes each
+    size_t slot_bytes;
+    size_t lane_bytes;      // V, X and Y of one lane: 128*r*(N+2)
+    uint64_t N;
+    uint32_t r, p;
+    size_t group;           // lanes per group
+    size_t n_groups;
+    unsigned workers;       // worker ids below this take part
+    atomic_size_t next;     // next unclaimed group
+} scrypt_job;
+
+typedef struct {
+    scrypt_ctx *ctx;
+    unsigned id;
+} scrypt_worker;
+
+struct scrypt_ctx {
+    pthread_mutex_t call;   // serializes scrypt_ctx_hash
+    pthread_mutex_t lock;   // guards job, gen, busy and quit
+    pthread_cond_t  wake;   // gen moved on, or quit
+    pthread_cond_t  idle;   // busy dropped to zero
+    scrypt_job *job;
+    uint64_t gen;
+    unsigned busy;
+    int quit;
+    unsigned threads;       // pool threads started + the caller
+    size_t max_mem;
+    uint8_t *arena;
+    size_t arena_size;
+    pthread_t tids[SCRYPT_MAX_THREADS];
+    scrypt_worker workers[SCRYPT_MAX_THREADS];
+};
+
+// Claim groups until none are left; worker id uses scratch slot id
+static void scrypt_run(scrypt_job *job, unsigned id) {
+    if (id >= job->workers) return;
+    uint32_t *mem = (uint32_t *)(job->slots + (size_t)id * job->slot_bytes);
+    size_t block_bytes = (size_t)128 * job->r;  // one lane of B
+    for (;;) {
+        size_t g = atomic_fetch_add_explicit(&job->next, 1, memory_order_relaxed);
+        if (g >= job->n_groups) break;
+        size_t first = g * job->group;
+        size_t n = job->p - first < job->group ? job->p - first : job->group;
+        scrypt_romix_lanes(job->B + first * block_bytes, n, job->N, job->r, mem);
+        // V[0] is a copy of the PBKDF2 output and X the ROMix result: either
+        // makes a password guess cheap to check, so nothing outlives the hash
+        arx_wipe(mem, n * job->lane_bytes);
+    }
+}
+
+// Pool thread: run every job announced by a new generation
+static void *scrypt_worker_main(void *arg) {
+    scrypt_worker *w = (scrypt_worker *)arg;
+    scrypt_ctx *c = w->ctx;
+    uint64_t seen = 0;
+    pthread_mutex_lock(&c->lock);
+    for (;;) {
+        while (c->gen == seen && !c->quit) {
+            pthread_cond_wait(&c->wake, &c->lock);
+        }
+        if (c->quit) break;
+        seen = c->gen;
+        scrypt_job *job = c->job;
+        pthread_mutex_unlock(&c->lock);
+        scrypt_run(job, w->id);
+        pthread_mutex_lock(&c->lock);
+        if (--c->busy == 0) pthread_cond_signal(&c->idle);
+    }
+    pthread_mutex_unlock(&c->lock);
+    return NULL;
+}
+
+scrypt_ctx *scrypt_ctx_create(const scrypt_opts *opts) {
+    scrypt_ctx *c = calloc(1, sizeof(*c));
+    if (c == NULL) return NULL;
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned threads = (opts && opts->threads) ? opts->threads
+                                               : (ncpu > 0 ? (unsigned)ncpu : 1);
+    if (threads > SCRYPT_MAX_THREADS) threads = SCRYPT_MAX_THREADS;
+    c->max_mem = opts ? opts->max_mem : 0;
+    pthread_mutex_init(&c->call, NULL);
+    pthread_mutex_init(&c->lock, NULL);
+    pthread_cond_init(&c->wake, NULL);
+    pthread_cond_init(&c->idle, NULL);
+
+    // Worker ids index scratch slots, so stop at the first thread that
+    // fails to start and keep the ids dense
+    c->threads = 1;
+    for (unsigned t = 1; t < threads; t++) {
+        c->workers[t].ctx = c;
+        c->workers[t].id = t;
+        if (pthread_create(&c->tids[t], NULL, scrypt_worker_main, &c->workers[t]) != 0) break;
+        c->threads++;
+    }
+    return c;
+}
+
+void scrypt_ctx_destroy(scrypt_ctx *c) {
+    if (c == NULL) return;
+    pthread_mutex_lock(&c->lock);
+    c->quit = 1;
+    pthread_cond_broadcast(&c->wake);
+    pthread_mutex_unlock(&c->lock);
+    for (unsigned t = 1; t < c->threads; t++) {
+        pthread_join(c->tids[t], NULL);
+    }
+    if (c->arena != NULL) {
+        arx_wipe(c->arena, c->arena_size);
+        free(c->arena);
+    }
+    pthread_cond_destroy(&c->idle);
+    pthread_cond_destroy(&c->wake);
+    pthread_mutex_destroy(&c->lock);
+    pthread_mutex_destroy(&c->call);
+    free(c);
+}
+
+// Make the arena at least `size` bytes (a multiple of 64); old contents
+// are not kept
+static int scrypt_arena_reserve(scrypt_ctx *c, size_t size) {
+    if (c->arena_size >= size) return 0;
+    if (c->arena != NULL) {
+        arx_wipe(c->arena, c->arena_size);
+        free(c->arena);
+    }
+    c->arena = aligned_alloc(64, size);
+    c->arena_size = c->arena ? size : 0;
+    return c->arena ? 0 : -1;
+}
+
+/*
+ * scrypt_plan(c, job, lane_bytes)
+ *   Lanes per group and workers for job->p lanes: spread over the threads
+ *   first, group only when p exceeds them, never more lanes in flight
+ *   than max_mem allows. Returns -1 if not even one lane fits.
+ */
+static int scrypt_plan(const scrypt_ctx *c, scrypt_job *job, size_t lane_bytes) {
+    size_t width = salsa_core_lanes_max();
+    if (width > SCRYPT_MAX_LANES) width = SCRYPT_MAX_LANES;
+    size_t threads = c->threads;
+    size_t group = (job->p + threads - 1) / threads;
+    if (group > width) group = width;
+    size_t workers = (job->p + group - 1) / group;
+    if (workers > threads) workers = threads;
+
+    if (c->max_mem) {
+        size_t budget = c->max_mem / lane_bytes;   // lanes in flight
+        if (budget == 0) return -1;
+        if (workers * group > budget) {
+            if (budget >= workers) {
+                group = budget / workers;
+            } else {
+                workers = budget;
+                group = 1;
+            }
+        }
+    }
+    job->group = group;
+    job->n_groups = (job->p + group - 1) / group;
+    job->workers = (unsigned)(workers < job->n_groups ? workers : job->n_groups);
+    return 0;
+}
+
+int scrypt_ctx_hash(scrypt_ctx *c, const uint8_t *pass, size_t pass_len,
+                    const uint8_t *salt, size_t salt_len,
+                    uint64_t N, uint32_t r, uint32_t p,
+                    uint8_t *out, size_t out_len) {
+    // RFC 7914: N a power of two below 2^(128*r/8), r*p < 2^30, and at
+    // most (2^32 - 1) * 32 bytes of output
+    if (c == NULL || N < 2 || (N & (N - 1)) != 0 || r == 0 || p == 0 ||
+        (uint64_t)r * p >= ((uint64_t)1 << 30) ||
+        (r < 4 && (N >> (16 * r)) != 0) ||
+        (uint64_t)out_len > (uint64_t)0xffffffff * 32) {
+        errno = EINVAL;
+        return -1;
+    }
+    // one lane's V, X and Y: 128*r*(N+2) bytes
+    size_t lane_bytes = (size_t)128 * r;
+    if (N > SIZE_MAX / lane_bytes - 2) {
+        errno = ENOMEM;
+        return -1;
+    }
+    lane_bytes *= (size_t)(N + 2);
+
+    scrypt_job job = { .N = N, .r = r, .p = p };
+    if (scrypt_plan(c, &job, lane_bytes) != 0) {
+        errno = ENOMEM;
+        return -1;
+    }
+    size_t b_bytes = (size_t)128 * r * p;           // a multiple of 64
+    job.lane_bytes = lane_bytes;
+    job.slot_bytes = job.group * lane_bytes;
+    if (job.slot_bytes > (SIZE_MAX - b_bytes) / job.workers) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    pthread_mutex_lock(&c->call);
+    if (scrypt_arena_reserve(c, b_bytes + job.workers * job.slot_bytes) != 0) {
+        pthread_mutex_unlock(&c->call);
+        errno = ENOMEM;
+        return -1;
+    }
+    job.B = c->arena;
+    job.slots = c->arena + b_bytes;
+    atomic_init(&job.next, 0);
+
+    hmac_sha256_key hk;
+    hmac_sha256_init(&hk, pass, pass_len);
+    pbkdf2_sha256_1(&hk, salt, salt_len, job.B, b_bytes);
+
+    if (job.workers <= 1) {
+        scrypt_run(&job, 0);
+    } else {
+        pthread_mutex_lock(&c->lock);
+        c->job = &job;
+        c->busy = c->threads - 1;
+        c->gen++;
+        pthread_cond_broadcast(&c->wake);
+        pthread_mutex_unlock(&c->lock);
+        // The caller is worker 0
+        scrypt_run(&job, 0);
+        pthread_mutex_lock(&c->lock);
+        while (c->busy > 0) {
+            pthread_cond_wait(&c->idle, &c->lock);
+        }
+        c->job = NULL;
+        pthread_mutex_unlock(&c->lock);
+    }
+
+    pbkdf2_sha256_1(&hk, job.B, b_bytes, out, out_len);
+    arx_wipe(job.B, b_bytes);
+    arx_wipe(&hk, sizeof(hk));
+    pthread_mutex_unlock(&c->call);
+    return 0;
+}
+
+int scrypt(const uint8_t *pass, size_t pass_len,
+           const uint8_t *salt, size_t salt_len,
+           uint64_t N, uint32_t r, uint32_t p,
+           uint8_t *out, size_t out_len) {
+    // One lane at a time, as sequential scrypt: max_mem of one lane keeps
+    // scrypt_plan from stacking lanes into SIMD groups (p times the memory)
+    scrypt_opts opts = { .threads = 1 };
+    if (r != 0 && N <= SIZE_MAX / ((size_t)128 * r) - 2) {
+        opts.max_mem = (size_t)128 * r * (size_t)(N + 2);
+    }
+    scrypt_ctx *c = scrypt_ctx_create(&opts);
+    if (c == NULL) {
+        errno = ENOMEM;
+        return -1;
+    }
+    int rc = scrypt_ctx_hash(c, pass, pass_len, salt, salt_len, N, r, p, out, out_len);
+    int saved = errno;
+    scrypt_ctx_destroy(c);
+    errno = saved;
+    return rc;
+}
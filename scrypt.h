@@ -0,0 +1,46 @@
+// scrypt.h
+// scrypt password hashing / key derivation (scrypt.c, RFC 7914) on the
+// Salsa20/8 core of salsa.c. A context keeps the ROMix memory and a pool
+// of worker threads between hashes.
+
+#ifndef SCRYPT_H
+#define SCRYPT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef struct scrypt_ctx scrypt_ctx;
+
+// Tuning knobs; a zeroed struct (or NULL) picks the defaults.
+typedef struct {
+    unsigned threads;   // worker count including the caller, 0 = online CPUs
+    size_t   max_mem;   // cap on ROMix memory in bytes, 0 = no cap
+} scrypt_opts;
+
+// NULL if memory for the context cannot be had; a thread that fails to
+// start only costs parallelism
+scrypt_ctx *scrypt_ctx_create(const scrypt_opts *opts);
+void scrypt_ctx_destroy(scrypt_ctx *c);
+
+// Derive out_len bytes from the password and salt with cost N (a power of
+// two > 1), block size r and parallelism p. The p lanes run on the pool;
+// the memory is reused by later calls and only grows. Every lane in
+// flight needs 128*r*(N+2) bytes, and up to threads * salsa_core_lanes_max()
+// lanes (at most p) run at once, so set max_mem to bound the peak; the
+// scratch is wiped before the call returns. Calls on one context are
+// serialized. Returns 0, or -1 with errno EINVAL for bad
+// parameters, ENOMEM if the memory (or max_mem) does not suffice for one
+// lane.
+int scrypt_ctx_hash(scrypt_ctx *c, const uint8_t *pass, size_t pass_len,
+                    const uint8_t *salt, size_t salt_len,
+                    uint64_t N, uint32_t r, uint32_t p,
+                    uint8_t *out, size_t out_len);
+
+// One-shot scrypt on the calling thread, with a context of its own; lanes
+// run one after another, so it needs 128*r*(N+2) bytes like plain scrypt
+int scrypt(const uint8_t *pass, size_t pass_len,
+           const uint8_t *salt, size_t salt_len,
+           uint64_t N, uint32_t r, uint32_t p,
+           uint8_t *out, size_t out_len);
+
+#endif
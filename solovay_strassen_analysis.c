@@ -10,6 +10,8 @@
 #include <math.h>
 #include <string.h>
 
+#include "chacha20_rng_gmp.h"
+
 // --- portable timing includes ---
 #if defined(__x86_64__) || defined(_M_X64)
   #include <x86intrin.h>  // for rdtsc on x86 CPUs
@@ -25,8 +27,7 @@
 #define TRIAL_RUNS 1000000    // Number of Solovay–Strassen trials for analysis
 #define GENERATION_ROUNDS 40  // Rounds for prime generation (high security)
 
-// Global random state
-gmp_randstate_t global_state;
+// Random bases and primes come from the ChaCha20 CSPRNG (chacha20_rng.c)
 
 // Timing utilities (portable rdtsc-like)
 static inline unsigned long long rdtsc(void) {
@@ -72,7 +73,7 @@ int solovay_strassen_single_round(const mpz_t n, mpz_t scratch_a, mpz_t scratch_
     mpz_t range, nm1;
     mpz_inits(range, nm1, NULL);
     mpz_sub_ui(range, n, 3);     // range size: n-3 → values 0..n-4
-    mpz_urandomm(scratch_a, global_state, range);
+    chacha_rng_mpz_below(scratch_a, range);
     mpz_add_ui(scratch_a, scratch_a, 2); // shift to 2..n-2
     mpz_sub_ui(nm1, n, 1);
 
@@ -133,7 +134,7 @@ void generate_prime(mpz_t prime, unsigned int bits, int rounds) {
     do {
         attempts++;
         // Generate random odd number with MSB set
-        mpz_urandomb(prime, global_state, bits);
+        chacha_rng_mpz_bits(prime, bits);
         mpz_setbit(prime, bits - 1);  // Ensure full bit length
         mpz_setbit(prime, 0);         // Make odd
 
@@ -340,10 +341,6 @@ void print_theoretical_analysis(void) {
 //==============================================================================
 
 int main(void) {
-    // Initialize random number generator
-    gmp_randinit_mt(global_state);
-    gmp_randseed_ui(global_state, time(NULL) ^ clock());
-
     printf("Solovay–Strassen Primality Test - Comprehensive Analysis\n");
     printf("========================================================\n");
     printf("Assignment: Primality Testing\n");
@@ -395,10 +392,10 @@ int main(void) {
 
     // Cleanup
     mpz_clears(p, q, n, NULL);
-    gmp_randclear(global_state);
 
     return 0;
 }
-//clang -O3 -std=c11 -flto -fomit-frame-pointer \
-  -I/opt/homebrew/include -L/opt/homebrew/lib \
-  -o ss_analysis solovay_strassen_analysis.c -lgmp
\ No newline at end of file
+// Build (Apple Silicon / Homebrew):
+// clang -O3 -std=c11 -flto -fomit-frame-pointer \
+//   -I/opt/homebrew/include -L/opt/homebrew/lib \
+//   -o ss_analysis solovay_strassen_analysis.c chacha20_rng.c chacha20_simd.c -lgmp -pthread
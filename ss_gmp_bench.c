@@ -5,7 +5,9 @@
 // Build (Apple Silicon / Homebrew):
 //   clang -O3 -flto -fomit-frame-pointer -mcpu=apple-m1 -std=c11 \
 //     -I/opt/homebrew/include -L/opt/homebrew/lib \
-//     -o ss_gmp_bench ss_gmp_bench.c -lgmp
+//     -o ss_gmp_bench ss_gmp_bench.c chacha20_rng.c chacha20_simd.c -lgmp -pthread
+//
+// Candidates and random bases come from the ChaCha20 CSPRNG (chacha20_rng.c).
 //
 // Examples:
 //   ./ss_gmp_bench
@@ -22,6 +24,8 @@
 #include <string.h>
 #include <time.h>
 
+#include "chacha20_rng_gmp.h"
+
 #if defined(__APPLE__)
   #include <mach/mach_time.h>
 #endif
@@ -123,7 +127,7 @@ static inline int ss_round(const mpz_t n, ss_ctx* c) {
 }
 
 // Returns 1 for probable prime, 0 for composite.
-static inline int is_probable_prime_ss(const mpz_t n, int rounds, gmp_randstate_t rng, ss_ctx* c) {
+static inline int is_probable_prime_ss(const mpz_t n, int rounds, ss_ctx* c) {
     // Quick rejects & exact small primes
     if (small_sieve_composite(n)) return 0;
 
@@ -145,7 +149,7 @@ static inline int is_probable_prime_ss(const mpz_t n, int rounds, gmp_randstate_
 
     // Random bases in [2, n-2]
     for (int i = k; i < rounds; ++i) {
-        mpz_urandomm(c->a, rng, c->n_minus_3);
+        chacha_rng_mpz_below(c->a, c->n_minus_3);
         mpz_add_ui(c->a, c->a, 2);
         if (!ss_round(n, c)) return 0;
     }
@@ -154,8 +158,8 @@ static inline int is_probable_prime_ss(const mpz_t n, int rounds, gmp_randstate_
 
 // ===================== Candidate generation, CLI, printing =====================
 
-static inline void rand_odd_bigint(mpz_t x, gmp_randstate_t rng, unsigned bits) {
-    mpz_urandomb(x, rng, bits);
+static inline void rand_odd_bigint(mpz_t x, unsigned bits) {
+    chacha_rng_mpz_bits(x, bits);
     mpz_setbit(x, bits-1); // exact bit-length
     mpz_setbit(x, 0);      // odd
 }
@@ -189,11 +193,6 @@ int main(int argc, char** argv) {
     }
     if (count <= 0 || bits < 16 || rounds < 1) { usage(argv[0]); return 1; }
 
-    // RNG
-    gmp_randstate_t rng;
-    gmp_randinit_default(rng);
-    gmp_randseed_ui(rng, (unsigned long)time(NULL));
-
     mpz_t n; mpz_init(n);
     ss_ctx ctx; ss_ctx_init(&ctx);
 
@@ -205,7 +204,7 @@ int main(int argc, char** argv) {
     char* hexbuf = NULL;
 
     for (int i = 0; i < count; ++i) {
-        rand_odd_bigint(n, rng, bits);
+        rand_odd_bigint(n, bits);
 
         unsigned long long t0 = read_cycles();
         int is_pp;
@@ -213,7 +212,7 @@ int main(int argc, char** argv) {
             // GMP’s tuned probabilistic test (often faster/stronger than SS)
             is_pp = mpz_probab_prime_p(n, rounds) > 0;
         } else {
-            is_pp = is_probable_prime_ss(n, rounds, rng, &ctx);
+            is_pp = is_probable_prime_ss(n, rounds, &ctx);
         }
         unsigned long long t1 = read_cycles();
 
@@ -246,6 +245,5 @@ int main(int argc, char** argv) {
     free(t);
     ss_ctx_clear(&ctx);
     mpz_clear(n);
-    gmp_randclear(rng);
     return 0;
 }
\ No newline at end of file
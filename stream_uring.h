@@ -0,0 +1,30 @@
+// stream_uring.h
+// io_uring read → encrypt → write pipeline (stream_uring.c) for any stream
+// cipher that can be driven through a callback.
+
+#ifndef STREAM_URING_H
+#define STREAM_URING_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Called once per buffer, strictly in file order, so stateful ciphers (a
+// chacha20_ctx, RC4) can simply continue their stream. offset is the file
+// position of buf[0]; every buffer but the last is buf_size bytes.
+typedef void (*stream_uring_fn)(void *arg, uint8_t *buf, size_t len, uint64_t offset);
+
+// Tuning knobs; a zeroed struct (or NULL) picks the defaults.
+typedef struct {
+    unsigned depth;     // buffers in flight, 0 = 8
+    size_t   buf_size;  // bytes per buffer, rounded up to 4096, 0 = 1 MiB
+} stream_uring_opts;
+
+// Read size bytes of in_fd, pass them through fn and write them to the same
+// offsets of out_fd (which may be in_fd for in-place encryption). Returns 0,
+// or -1 with errno set; errno ENOSYS means io_uring is not available here
+// (missing, disabled, or its rings cannot be locked in memory) and the
+// caller should use another path.
+int stream_uring_run(int in_fd, int out_fd, uint64_t size,
+                     stream_uring_fn fn, void *arg, const stream_uring_opts *opts);
+
+#endif
@@ -0,0 +1,122 @@
+// xsalsa20poly1305.c
+// XSalsa20-Poly1305 secretbox (NaCl crypto_secretbox), single pass.
+//
+//   subkey               = HSalsa20(key, nonce[0..15])
+//   block 0              = Salsa20(subkey, nonce[16..23], counter 0)
+//   one-time Poly1305 key = bytes 0..31 of block 0
+//   ciphertext           = message XOR the keystream from byte 32 of block 0 on
+//   tag                  = Poly1305(ciphertext)
+//
+// Unlike the RFC 8439 AEAD there is no associated data and no padding or
+// length block. After the first 32 bytes the keystream is block aligned
+// again, so the message is walked in XSALSA20POLY1305_CHUNK pieces that go
+// through salsa20_djb_xor (SIMD kernels) and then Poly1305 while still in
+// L1, and the data is read from memory once. Open authenticates each
+// ciphertext piece before decrypting it, which keeps pt == ct correct.
+//
+// Build: gcc -O3 -std=c11 -c xsalsa20poly1305.c salsa.c poly1305.c
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "arx_simd.h"
+#include "salsa.h"
+#include "poly1305.h"
+#include "xsalsa20poly1305.h"
+
+// Multiple of 64 so every piece starts on a block boundary
+#ifndef XSALSA20POLY1305_CHUNK
+#define XSALSA20POLY1305_CHUNK 4096
+#endif
+
+// Derive the subkey and block 0: Poly1305 is keyed from its first half,
+// the second half is returned in head[] for the first 32 message bytes.
+static void box_init(uint8_t subkey[32], uint8_t head[32], poly1305_ctx *pc,
+                     const uint8_t key[32], const uint8_t nonce[24]) {
+    uint8_t block0[64] = {0};
+    hsalsa20(subkey, key, nonce);
+    salsa20_djb_xor(block0, block0, sizeof(block0), subkey, nonce + 16, 0);
+    poly1305_init(pc, block0);
+    memcpy(head, block0 + 32, 32);
+    arx_wipe(block0, sizeof(block0));
+}
+
+// Bytes 32.. of the message: piece at offset off uses block 1 + off/64
+static void box_body(uint8_t *dst, const uint8_t *src, size_t len,
+                     const uint8_t subkey[32], const uint8_t nonce[24],
+                     poly1305_ctx *pc, int seal) {
+    for (size_t off = 0; off < len; off += XSALSA20POLY1305_CHUNK) {
+        size_t n = len - off < XSALSA20POLY1305_CHUNK ? len - off : XSALSA20POLY1305_CHUNK;
+        uint64_t block = 1 + (uint64_t)(off / 64);
+        if (seal) {
+            salsa20_djb_xor(dst + off, src + off, n, subkey, nonce + 16, block);
+            poly1305_update(pc, dst + off, n);
+        } else {
+            poly1305_update(pc, src + off, n);
+            salsa20_djb_xor(dst + off, src + off, n, subkey, nonce + 16, block);
+        }
+    }
+}
+
+void xsalsa20poly1305_seal(uint8_t *ct, uint8_t tag[16],
+                           const uint8_t *pt, size_t len,
+                           const uint8_t key[32], const uint8_t nonce[24]) {
+    uint8_t subkey[32], head[32];
+    poly1305_ctx pc;
+    box_init(subkey, head, &pc, key, nonce);
+
+    size_t h = len < 32 ? len : 32;
+    for (size_t i = 0; i < h; i++) {
+        ct[i] = pt[i] ^ head[i];
+    }
+    poly1305_update(&pc, ct, h);
+    box_body(ct + h, pt + h, len - h, subkey, nonce, &pc, 1);
+    poly1305_finish(&pc, tag);
+    arx_wipe(subkey, sizeof(subkey));
+    arx_wipe(head, sizeof(head));
+}
+
+int xsalsa20poly1305_open(uint8_t *pt,
+                          const uint8_t *ct, size_t len,
+                          const uint8_t tag[16],
+                          const uint8_t key[32], const uint8_t nonce[24]) {
+    uint8_t subkey[32], head[32], calc[16];
+    poly1305_ctx pc;
+    box_init(subkey, head, &pc, key, nonce);
+
+    size_t h = len < 32 ? len : 32;
+    poly1305_update(&pc, ct, h);
+    for (size_t i = 0; i < h; i++) {
+        pt[i] = ct[i] ^ head[i];
+    }
+    box_body(pt + h, ct + h, len - h, subkey, nonce, &pc, 0);
+    poly1305_finish(&pc, calc);
+    arx_wipe(subkey, sizeof(subkey));
+    arx_wipe(head, sizeof(head));
+
+    // Constant-time compare: no early exit on the first differing byte
+    uint8_t diff = 0;
+    for (int i = 0; i < 16; i++) {
+        diff |= (uint8_t)(calc[i] ^ tag[i]);
+    }
+    if (diff != 0) {
+        memset(pt, 0, len);
+        return -1;
+    }
+    return 0;
+}
+
+void secretbox_easy(uint8_t *out, const uint8_t *pt, size_t len,
+                    const uint8_t key[32], const uint8_t nonce[24]) {
+    xsalsa20poly1305_seal(out + SECRETBOX_MACBYTES, out, pt, len, key, nonce);
+}
+
+int secretbox_open_easy(uint8_t *pt, const uint8_t *in, size_t in_len,
+                        const uint8_t key[32], const uint8_t nonce[24]) {
+    if (in_len < SECRETBOX_MACBYTES) {
+        return -1;
+    }
+    return xsalsa20poly1305_open(pt, in + SECRETBOX_MACBYTES, in_len - SECRETBOX_MACBYTES,
+                                 in, key, nonce);
+}
@@ -0,0 +1,38 @@
+// xsalsa20poly1305.h
+// XSalsa20-Poly1305 secretbox, compatible with NaCl/libsodium
+// crypto_secretbox, see xsalsa20poly1305.c.
+
+#ifndef XSALSA20POLY1305_H
+#define XSALSA20POLY1305_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define SECRETBOX_KEYBYTES   32
+#define SECRETBOX_NONCEBYTES 24
+#define SECRETBOX_MACBYTES   16
+
+// Encrypt len bytes of pt into ct (may alias) and write the 16-byte tag
+// (crypto_secretbox_detached)
+void xsalsa20poly1305_seal(uint8_t *ct, uint8_t tag[16],
+                           const uint8_t *pt, size_t len,
+                           const uint8_t key[32], const uint8_t nonce[24]);
+
+// Verify tag and decrypt ct into pt (may alias). Returns 0 on success,
+// -1 if the tag does not match; pt is zeroed in that case.
+// (crypto_secretbox_open_detached)
+int xsalsa20poly1305_open(uint8_t *pt,
+                          const uint8_t *ct, size_t len,
+                          const uint8_t tag[16],
+                          const uint8_t key[32], const uint8_t nonce[24]);
+
+// Combined format of crypto_secretbox_easy: out = tag | ciphertext, so out
+// holds len + SECRETBOX_MACBYTES bytes. pt and out must not overlap.
+void secretbox_easy(uint8_t *out, const uint8_t *pt, size_t len,
+                    const uint8_t key[32], const uint8_t nonce[24]);
+// in_len includes the tag; writes in_len - SECRETBOX_MACBYTES bytes.
+// Returns 0 on success, -1 on a bad tag or an input shorter than the tag.
+int secretbox_open_easy(uint8_t *pt, const uint8_t *in, size_t in_len,
+                        const uint8_t key[32], const uint8_t nonce[24]);
+
+#endif